@@ -0,0 +1,124 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COLOR_PIPELINE_H
+#define COLOR_PIPELINE_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+/**
+ * @brief Lookup tables combining gamma, calibration and brightness
+ *
+ * Entries are 8.8 fixed point output values from 0 to 255.0.
+ */
+class ColorLut
+{
+public:
+    uint16_t red[256];
+    uint16_t green[256];
+    uint16_t blue[256];
+
+    // Brightness the tables were built for, -1 if not built yet
+    int16_t brightness = -1;
+
+    // Any entry has fractional bits, dithering has nothing to do otherwise
+    bool fractional = true;
+};
+
+/**
+ * @brief Final output stage between led colors and the strips
+ */
+class ColorPipeline
+{
+private:
+    const CRGB *input;
+    CRGB *output;
+    uint16_t count;
+
+    // Gamma curve, 0..65535
+    uint16_t gamma[256];
+    uint8_t calibration[3];
+
+    // Per channel residue for temporal dithering, nullptr if disabled
+    uint8_t *error = nullptr;
+
+    /**
+     * @brief Rebuild lookup tables for a brightness
+     *
+     * @param lut Tables to build
+     * @param brightness Brightness
+     */
+    void build(ColorLut &lut, uint8_t brightness);
+
+public:
+    /**
+     * @brief Output stage applying gamma, white balance and brightness
+     *
+     * @param _input Led colors
+     * @param _output Led colors sent to the strips
+     * @param _count Led count of both buffers
+     * @param _gamma Gamma exponent, 1.0 disables correction
+     * @param _calibration Red, green and blue channel scale
+     * @param _dithering Enable temporal dithering
+     */
+    ColorPipeline(const CRGB *_input, CRGB *_output, uint16_t _count, float _gamma, const uint8_t _calibration[3], bool _dithering);
+
+    /**
+     * @brief Is temporal dithering enabled
+     *
+     * Dithering only works while frames are shown continuously.
+     *
+     * @return true
+     * @return false
+     */
+    bool isDithering();
+
+    /**
+     * @brief Does a range need to be shown every frame for dithering
+     *
+     * @param lut Lookup tables of the range
+     * @param scale Scale of the range
+     * @return true
+     * @return false
+     */
+    bool isDithering(const ColorLut &lut, uint8_t scale);
+
+    /**
+     * @brief Convert a range of leds into the output buffer
+     *
+     * The lookup tables are only rebuilt if the brightness changed. The
+     * scale is applied on top of the tables for fast changing brightness
+     * like the pulse effect.
+     *
+     * @param offset First led
+     * @param length Led count
+     * @param lut Lookup tables of the range
+     * @param brightness Brightness of the range
+     * @param scale Scale of the table values, 255 keeps them unchanged
+     */
+    void apply(uint16_t offset, uint16_t length, ColorLut &lut, uint8_t brightness, uint8_t scale = 255);
+};
+
+#endif
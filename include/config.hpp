@@ -46,6 +46,15 @@ public:
     String mqttHaDiscoveryTopicPrefix;
     String mqttHaUniqueId;
 
+    // Optional settings
+    bool realtimeEnabled = false;
+    bool mqttTls = false;
+    String mqttTlsFingerprint = "";
+    String mqttTlsCaFile = "/ca.pem";
+    float gamma = 1.0;
+    uint8_t colorCalibration[3] = {255, 255, 255};
+    bool dithering = false;
+
     Config(String _ssid,
            String _pass,
            String _mqttServer,
@@ -110,14 +119,25 @@ public:
             }
         }
 
-        return new Config(data["wifi_ssid"],
-                          data["wifi_pass"],
-                          data["mqtt_server"],
-                          data["mqtt_port"],
-                          data["mqtt_user"],
-                          data["mqtt_pass"],
-                          data["mqtt_ha_discovery_topic_prefix"],
-                          data["mqtt_ha_unique_id"]);
+        Config *config = new Config(data["wifi_ssid"],
+                                    data["wifi_pass"],
+                                    data["mqtt_server"],
+                                    data["mqtt_port"],
+                                    data["mqtt_user"],
+                                    data["mqtt_pass"],
+                                    data["mqtt_ha_discovery_topic_prefix"],
+                                    data["mqtt_ha_unique_id"]);
+        config->realtimeEnabled = data["realtime_enabled"] | false;
+        config->mqttTls = data["mqtt_tls"] | false;
+        config->mqttTlsFingerprint = data["mqtt_tls_fingerprint"] | "";
+        config->mqttTlsCaFile = data["mqtt_tls_ca_file"] | "/ca.pem";
+        config->gamma = data["gamma"] | 1.0;
+        for (int i = 0; i < 3; i++)
+        {
+            config->colorCalibration[i] = data["color_calibration"][i] | 255;
+        }
+        config->dithering = data["dithering"] | false;
+        return config;
     }
 };
 
@@ -0,0 +1,209 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EFFECT_VM_H
+#define EFFECT_VM_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "LittleFS.h"
+
+#include <vector>
+
+// Maximum bytecode size of a program
+#define VM_MAX_PROGRAM_SIZE 256
+
+// Evaluation stack depth
+#define VM_STACK_SIZE 16
+
+// Instructions executed per frame over all segments
+#define VM_FRAME_BUDGET 20000
+
+// Maximum number of stored programs
+#define VM_MAX_PROGRAMS 4
+
+// Maximum program name length
+#define VM_MAX_NAME_LENGTH 16
+
+// LittleFS directory of stored programs
+#define VM_PROGRAM_DIR "/effects"
+
+// Fixed point values are 16.16, 1.0 == VM_ONE
+#define VM_ONE 65536
+
+// OP_TIME wraps to 0 after this many seconds, the largest 16.16 range
+#define VM_TIME_PERIOD 32768UL
+
+/**
+ * @brief Effect bytecode instructions
+ *
+ * Every program is evaluated once per pixel and must end with OP_HSV or OP_RGB.
+ * There are no jumps, so the instruction count per pixel is known after validation.
+ */
+enum VmOpcode : uint8_t
+{
+    // Push 32 bit little endian immediate
+    OP_PUSH = 0x01,
+    // Push seconds since boot modulo VM_TIME_PERIOD (about 9.1h). frac(time * k)
+    // stays continuous across the wrap if k * VM_TIME_PERIOD is a whole number
+    OP_TIME = 0x02,
+    // Push pixel index
+    OP_INDEX = 0x03,
+    // Push pixel count
+    OP_COUNT = 0x04,
+    // Push pixel position 0..1
+    OP_POS = 0x05,
+
+    OP_DUP = 0x10,
+    OP_DROP = 0x11,
+    OP_SWAP = 0x12,
+
+    OP_ADD = 0x20,
+    OP_SUB = 0x21,
+    OP_MUL = 0x22,
+    OP_DIV = 0x23,
+    OP_MOD = 0x24,
+    OP_MIN = 0x25,
+    OP_MAX = 0x26,
+    OP_NEG = 0x27,
+    OP_ABS = 0x28,
+    OP_FRAC = 0x29,
+
+    // a b -> 1.0 if a < b else 0
+    OP_LT = 0x30,
+    // c a b -> a if c != 0 else b
+    OP_SEL = 0x31,
+
+    // Sine of turns (1.0 == 360 degrees), -1..1
+    OP_SIN = 0x40,
+
+    // h s v -> pixel color, all 0..1
+    OP_HSV = 0x50,
+    // r g b -> pixel color, all 0..1
+    OP_RGB = 0x51
+};
+
+/**
+ * @brief Validated per pixel effect program
+ */
+class EffectProgram
+{
+private:
+    uint8_t code[VM_MAX_PROGRAM_SIZE];
+    size_t size = 0;
+
+    // Instructions executed per pixel
+    uint16_t instructions = 0;
+
+public:
+    String name;
+
+    /**
+     * @brief Validate and load bytecode
+     *
+     * Checks opcodes, immediates and stack depth so that the interpreter
+     * can run without any bounds checks.
+     *
+     * @param _name Effect name
+     * @param data Bytecode
+     * @param length Bytecode byte count
+     * @return true Program is valid and loaded
+     * @return false
+     */
+    bool load(String _name, const uint8_t *data, size_t length);
+
+    /**
+     * @brief Is a program loaded
+     *
+     * @return true
+     * @return false
+     */
+    bool isLoaded();
+
+    /**
+     * @brief Unload program
+     */
+    void clear();
+
+    /**
+     * @brief Render pixels until done or the instruction budget is used up
+     *
+     * Rendering continues at nextPixel with the next call if the budget ran out.
+     *
+     * @param leds Target leds
+     * @param count Led count
+     * @param nextPixel First pixel to render, updated
+     * @param time Time in ms
+     * @param budget Remaining instructions in this frame, updated
+     * @return true All pixels rendered
+     * @return false Budget exhausted
+     */
+    bool run(CRGB *leds, uint16_t count, uint16_t &nextPixel, uint32_t time, uint32_t &budget);
+};
+
+/**
+ * @brief Programs stored in LittleFS
+ */
+class EffectLibrary
+{
+private:
+    EffectProgram programs[VM_MAX_PROGRAMS];
+
+public:
+    /**
+     * @brief Load all stored programs
+     *
+     * LittleFS has to be mounted.
+     */
+    void load();
+
+    /**
+     * @brief Validate, store and load a program
+     *
+     * An empty program deletes the effect.
+     *
+     * @param name Effect name
+     * @param data Bytecode
+     * @param length Bytecode byte count
+     * @return EffectProgram* Changed program or nullptr on errors
+     */
+    EffectProgram *store(String name, const uint8_t *data, size_t length);
+
+    /**
+     * @brief Find loaded program
+     *
+     * @param name Effect name
+     * @return EffectProgram* Program or nullptr
+     */
+    EffectProgram *find(const char *name);
+
+    /**
+     * @brief Names of all loaded programs
+     *
+     * @return std::vector<String>
+     */
+    std::vector<String> names();
+};
+
+#endif
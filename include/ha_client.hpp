@@ -29,26 +29,71 @@
 #include "network.hpp"
 
 #include <tuple>
+#include <vector>
+
+// Maximum command payload size, longer payloads are ignored
+#define HA_MAX_PAYLOAD_SIZE 32
+
+// State fields waiting to be published
+#define HA_STATE_SWITCH 0x01
+#define HA_STATE_BRIGHTNESS 0x02
+#define HA_STATE_RGB 0x04
+#define HA_STATE_EFFECT 0x08
+#define HA_STATE_ALL 0x0F
+
+/**
+ * @brief Home Assistant light entity
+ */
+class HaEntity
+{
+public:
+    String id;
+    String name;
+
+    // Topics
+    String uniqueId;
+    String discoveryTopic;
+    String stateTopic;
+    String commandTopic;
+    String brightnessStateTopic;
+    String brightnessCommandTopic;
+    String rgbStateTopic;
+    String rgbCommandTopic;
+    String effectStateTopic;
+    String effectCommandTopic;
+
+    // HA_STATE_* fields to publish with the next loop
+    uint8_t pendingState = HA_STATE_ALL;
+
+    /**
+     * @brief Light entity
+     *
+     * @param _id Entity id, empty for the main light
+     * @param _name Display name
+     */
+    HaEntity(String _id, String _name)
+    {
+        id = _id;
+        name = _name;
+    }
+};
 
 class HaClient
 {
 private:
-    // Topics
-    const String stateTopic = "iskaerna/smart/light/status";
-    const String commandTopic = "iskaerna/smart/light/switch";
-    const String availabilityTopic = "iskaerna/smart/light/availability";
-    const String brightnessStateTopic = "iskaerna/smart/brightness/status";
-    const String brightnessCommandTopic = "iskaerna/smart/brightness/set";
-    const String rgbStateTopic = "iskaerna/smart/rgb/status";
-    const String rgbCommandTopic = "iskaerna/smart/rgb/set";
-    const String effectStateTopic = "iskaerna/smart/effect/status";
-    const String effectCommandTopic = "iskaerna/smart/effect/set";
+    // Per device topic namespace derived from the unique id
+    String topicPrefix;
+    String availabilityTopic;
+    String programTopic;
+    String commandSubscription;
+    String segmentCommandSubscription;
+    String programSubscription;
 
     Config *config;
     NetworkClient *networkClient;
+    std::vector<HaEntity> entities;
+    std::vector<String> effects;
     String haStatusTopic;
-    String discoveryTopic;
-    String discoveryMessage;
 
     /**
      * @brief Handle incomming MQTT messages
@@ -59,21 +104,55 @@ private:
      */
     void mqttCallback(char *topic, byte *payload, unsigned int length);
 
-    std::function<bool()> getToggleState;
-    std::function<int()> getBrightness;
-    std::function<std::tuple<int, int, int>()> getColor;
-    std::function<String()> getEffect;
+    /**
+     * @brief Can an id be used as topic level
+     *
+     * @param id Unique or entity id
+     * @return true Non-empty and only a-z, A-Z, 0-9, _ and -
+     * @return false
+     */
+    static bool isTopicSafe(const String &id);
 
-    std::function<void(bool)> onToggleState;
-    std::function<void(int)> onSetBrightness;
-    std::function<void(int, int, int)> onSetColor;
-    std::function<void(String)> onSetEffect;
+    /**
+     * @brief Find entity by id
+     *
+     * @param id Entity id, not null terminated
+     * @param length Entity id length
+     * @return int Entity index or -1
+     */
+    int findEntity(const char *id, size_t length);
+
+    /**
+     * @brief Publish discovery message of an entity
+     *
+     * @param entity Entity index
+     */
+    void publishDiscovery(int entity);
+
+    /**
+     * @brief Publish pending state fields of all entities
+     */
+    void flushState();
+
+    std::function<bool(int)> getToggleState;
+    std::function<int(int)> getBrightness;
+    std::function<std::tuple<int, int, int>(int)> getColor;
+    std::function<const char *(int)> getEffect;
+
+    std::function<void(int, bool)> onToggleState;
+    std::function<void(int, int)> onSetBrightness;
+    std::function<void(int, int, int, int)> onSetColor;
+    std::function<void(int, const char *)> onSetEffect;
+    std::function<void(String, const uint8_t *, unsigned int)> onUploadEffect;
 
 public:
     /**
      * @brief Client abstraction for Home Assistant
      *
+     * All getters and callbacks receive the entity index as first parameter.
+     *
      * @param _config Config file
+     * @param _entities Light entities
      * @param _getToggleState Getter for current light state
      * @param _getBrightness Getter for brightness
      * @param _getColor Getter for rgb color
@@ -82,18 +161,22 @@ public:
      * @param _onSetBrightness Brightness change callback
      * @param _onSetColor Color change callback
      * @param _onSetEffect Effect change callback
+     * @param _onUploadEffect Effect program upload callback
      */
     HaClient(Config *_config,
-             std::function<bool()> _getToggleState,
-             std::function<int()> _getBrightness,
-             std::function<std::tuple<int, int, int>()> _getColor,
-             std::function<String()> _getEffect,
-             std::function<void(bool)> _onToggleState,
-             std::function<void(unsigned int)> _onSetBrightness,
-             std::function<void(int, int, int)> _onSetColor,
-             std::function<void(String)> _onSetEffect)
+             std::vector<HaEntity> _entities,
+             std::function<bool(int)> _getToggleState,
+             std::function<int(int)> _getBrightness,
+             std::function<std::tuple<int, int, int>(int)> _getColor,
+             std::function<const char *(int)> _getEffect,
+             std::function<void(int, bool)> _onToggleState,
+             std::function<void(int, int)> _onSetBrightness,
+             std::function<void(int, int, int, int)> _onSetColor,
+             std::function<void(int, const char *)> _onSetEffect,
+             std::function<void(String, const uint8_t *, unsigned int)> _onUploadEffect)
     {
         config = _config;
+        entities = _entities;
         getToggleState = _getToggleState;
         getBrightness = _getBrightness;
         getColor = _getColor;
@@ -102,39 +185,53 @@ public:
         onSetBrightness = _onSetBrightness;
         onSetColor = _onSetColor;
         onSetEffect = _onSetEffect;
+        onUploadEffect = _onUploadEffect;
         networkClient = new NetworkClient(_config, [this](char *topic, byte *payload, unsigned int length)
                                           { mqttCallback(topic, payload, length); });
 
         haStatusTopic = String(config->mqttHaDiscoveryTopicPrefix + "/status");
-        discoveryTopic = String(config->mqttHaDiscoveryTopicPrefix + String("/light/") + String(config->mqttHaUniqueId + "/config"));
-
-        // Disconver message
-        DynamicJsonDocument json(1024);
-        json["unique_id"] = config->mqttHaUniqueId;
-        json["name"] = "Ikea Iskaerna Smart";
-        json["state_topic"] = stateTopic;
-        json["command_topic"] = commandTopic;
-        json["availability_topic"] = availabilityTopic;
-        json["brightness_state_topic"] = brightnessStateTopic;
-        json["brightness_command_topic"] = brightnessCommandTopic;
-        json["rgb_state_topic"] = rgbStateTopic;
-        json["rgb_command_topic"] = rgbCommandTopic;
-        json["effect_state_topic"] = effectStateTopic;
-        json["effect_command_topic"] = effectCommandTopic;
-        JsonArray ports = json.createNestedArray("effect_list");
-        ports.add("none");
-        ports.add("rainbow");
-        ports.add("pulse");
-        json["state_value_template"] = "{{ value_json.state }}";
-        json["availability_template"] = "{{ value }}";
-        json["brightness_value_template"] = "{{ value_json.brightness }}";
-        json["rgb_value_template"] = "{{ value_json.rgb | join(',') }}";
-        json["effect_command_template"] = "{{ value }}";
-        json["qos"] = 0;
-        json["payload_on"] = "ON";
-        json["payload_off"] = "OFF";
-        json["optimistic"] = true;
-        serializeJson(json, discoveryMessage);
+
+        // Unique id is used verbatim, e.g. iskaerna/IkeaSkaernaSmart. Ids that
+        // would need cleaning up are rejected so that two lamps never share a prefix
+        if (!isTopicSafe(config->mqttHaUniqueId))
+        {
+            Serial.printf("mqtt_ha_unique_id '%s' must be non-empty and only contain a-z, A-Z, 0-9, _ and -\n", config->mqttHaUniqueId.c_str());
+            for (;;)
+            {
+                delay(100);
+            }
+        }
+        topicPrefix = "iskaerna/" + config->mqttHaUniqueId;
+        availabilityTopic = topicPrefix + "/availability";
+        programTopic = topicPrefix + "/program/";
+        commandSubscription = topicPrefix + "/+/set";
+        segmentCommandSubscription = topicPrefix + "/+/+/set";
+        programSubscription = programTopic + "+";
+
+        // Topics follow <prefix>/[<entity id>/]<field>/<status|set>. Entity ids
+        // follow the unique id rule, program is taken by effect uploads
+        for (HaEntity &entity : entities)
+        {
+            if (entity.id.length() > 0 && (!isTopicSafe(entity.id) || entity.id == "program"))
+            {
+                Serial.printf("Segment id '%s' must not be 'program' and only contain a-z, A-Z, 0-9, _ and -\n", entity.id.c_str());
+                for (;;)
+                {
+                    delay(100);
+                }
+            }
+            String base = entity.id.length() > 0 ? topicPrefix + "/" + entity.id : topicPrefix;
+            entity.uniqueId = entity.id.length() > 0 ? config->mqttHaUniqueId + "_" + entity.id : config->mqttHaUniqueId;
+            entity.discoveryTopic = config->mqttHaDiscoveryTopicPrefix + "/light/" + entity.uniqueId + "/config";
+            entity.stateTopic = base + "/state/status";
+            entity.commandTopic = base + "/state/set";
+            entity.brightnessStateTopic = base + "/brightness/status";
+            entity.brightnessCommandTopic = base + "/brightness/set";
+            entity.rgbStateTopic = base + "/rgb/status";
+            entity.rgbCommandTopic = base + "/rgb/set";
+            entity.effectStateTopic = base + "/effect/status";
+            entity.effectCommandTopic = base + "/effect/set";
+        }
     }
 
     /**
@@ -149,10 +246,37 @@ public:
      *
      * - Checks connection state and reconnects if needed
      * - Setup with Home Assistant
+     * - Publishes changed entity states
      *
      * Please call inside your main loop.
      */
     void loop();
+
+    /**
+     * @brief Set effects advertised to Home Assistant
+     *
+     * Discovery is resent if already connected.
+     *
+     * @param _effects Effect names
+     */
+    void setEffects(std::vector<String> _effects);
+
+    /**
+     * @brief Publish current state of all entities
+     *
+     * Use when the state changed outside of Home Assistant commands.
+     */
+    void publishState();
+
+    /**
+     * @brief Does the client need the loop to run
+     *
+     * True while disconnected or if MQTT data is waiting.
+     *
+     * @return true
+     * @return false
+     */
+    bool hasPendingWork();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,90 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+
+// Heap sample interval
+#define HEAP_SAMPLE_INTERVAL 10000
+
+// Length of one statistics window
+#define HEAP_WINDOW_LENGTH 600000
+
+// Consecutive windows with a lower minimum until a leak is reported
+#define HEAP_LEAK_WINDOWS 6
+
+// Warn if the largest free block drops below this size
+#define HEAP_MIN_FREE_BLOCK 4096
+
+class HeapMonitor
+{
+private:
+    unsigned long lastSample = 0;
+    unsigned long windowStart = 0;
+
+    // Minimum values of the current window
+    uint32_t minFreeHeap = UINT32_MAX;
+    uint32_t minFreeBlock = UINT32_MAX;
+    uint8_t maxFragmentation = 0;
+
+    // Minimum free heap of the previous window
+    uint32_t lastWindowFreeHeap = UINT32_MAX;
+    int shrinkingWindows = 0;
+    bool lowBlockReported = false;
+
+    /**
+     * @brief Sample heap and warn about small free blocks
+     */
+    void sample();
+
+    /**
+     * @brief Print window statistics and check for steady decline
+     */
+    void report();
+
+public:
+    /**
+     * @brief Tracks free heap, largest free block and fragmentation
+     *
+     * Reports statistics on the serial console and warns if the free
+     * heap keeps shrinking or the largest free block gets too small.
+     */
+    HeapMonitor() {}
+
+    /**
+     * @brief Monitor setup
+     */
+    void setup();
+
+    /**
+     * @brief Sample heap if due
+     *
+     * Please call inside your main loop.
+     */
+    void loop();
+};
+
+#endif
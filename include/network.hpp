@@ -29,17 +29,47 @@
 
 #include <Arduino.h>
 #include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
 #include <PubSubClient.h>
 
 #define MQTT_PACKET_BUFFER_SIZE 2048
 
+// Requested TLS maximum fragment length
+#define TLS_FRAGMENT_LENGTH 512
+
+// TLS receive buffer if the broker does not support fragment length negotiation
+#define TLS_DEFAULT_RX_BUFFER_SIZE 16384
+
+// NTP server used for certificate date validation
+#define TLS_NTP_SERVER "pool.ntp.org"
+
+// Maximum wait for NTP time sync in ms
+#define TLS_NTP_TIMEOUT 10000
+
 class NetworkClient
 {
 private:
     Config *config;
     std::function<void(char *, uint8_t *, unsigned int)> callback;
-    WiFiClient wifiClient;
-    PubSubClient *mqttClient;
+    WiFiClient *wifiClient = nullptr;
+    PubSubClient *mqttClient = nullptr;
+
+    // TLS state, only used if enabled in config
+    BearSSL::WiFiClientSecure *secureClient = nullptr;
+    BearSSL::Session tlsSession;
+    BearSSL::X509List *trustAnchors = nullptr;
+    // Set once fragment length support of the broker is known
+    bool tlsBuffersConfigured = false;
+
+    /**
+     * @brief Create TLS client and load pinned fingerprint or trust anchors
+     */
+    void setupTls();
+
+    /**
+     * @brief Negotiate small TLS buffers and sync time once WiFi is up
+     */
+    void prepareTls();
 
 public:
     /**
@@ -64,7 +94,7 @@ public:
      * @param willRetain MQTT retain message
      * @param willMessage MQTT will message
      */
-    void connect(String willTopic, uint8_t willQos, boolean willRetain, String willMessage);
+    void connect(const String &willTopic, uint8_t willQos, boolean willRetain, const char *willMessage);
 
     /**
      * @brief Is wifi and mqtt connected
@@ -74,6 +104,14 @@ public:
      */
     bool isConnected();
 
+    /**
+     * @brief Is received data waiting to be processed
+     *
+     * @return true
+     * @return false
+     */
+    bool hasPendingData();
+
     /**
      * @brief Network setup
      */
@@ -84,7 +122,7 @@ public:
      *
      * @param topic Target topic
      */
-    void subscribe(String topic);
+    void subscribe(const String &topic);
 
     /**
      * @brief Publish MQTT message
@@ -92,7 +130,17 @@ public:
      * @param topic Target topic
      * @param payload Payload
      */
-    void publish(String topic, String payload);
+    void publish(const String &topic, const char *payload);
+
+    /**
+     * @brief Publish JSON document
+     *
+     * The document is serialized without intermediate String.
+     *
+     * @param topic Target topic
+     * @param json Payload
+     */
+    void publish(const String &topic, JsonDocument &json);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,123 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+// Frame delay while an effect is running
+#define ACTIVE_FRAME_DELAY 50
+
+// Frame delay while temporal dithering is active
+#define DITHER_FRAME_DELAY 10
+
+// Frame delay while realtime input is streaming
+#define REALTIME_FRAME_DELAY 2
+
+// Poll interval while idle. Roughly one beacon interval, the radio
+// does not deliver packets any faster while it is asleep
+#define IDLE_POLL_INTERVAL 100
+
+// Maximum idle sleep. Must stay well below the MQTT keepalive (15s)
+#define IDLE_MAX_SLEEP 5000
+
+// Beacon listen interval during light sleep
+#define IDLE_LISTEN_INTERVAL 3
+
+// Duty cycle report interval
+#define POWER_STATS_INTERVAL 60000
+
+enum PowerMode
+{
+    // Nothing is animating, radio in light sleep
+    POWER_IDLE,
+    // Effect is running, radio in modem sleep
+    POWER_ACTIVE,
+    // Dithered frames are shown continuously, radio in modem sleep
+    POWER_DITHER,
+    // Realtime input is streaming, radio always on
+    POWER_REALTIME
+};
+
+class PowerManager
+{
+private:
+    std::function<bool()> hasPendingWork;
+
+    PowerMode mode = POWER_ACTIVE;
+    unsigned long frameStart = 0;
+    unsigned long lastReport = 0;
+
+    // Statistics since last report
+    unsigned long busyTime = 0;
+    unsigned long activeSleepTime = 0;
+    unsigned long idleSleepTime = 0;
+    unsigned long activeFrames = 0;
+    unsigned long idleFrames = 0;
+
+    /**
+     * @brief Switch WiFi sleep mode on power mode changes
+     *
+     * @param _mode Power mode
+     */
+    void setMode(PowerMode _mode);
+
+    /**
+     * @brief Print duty cycle statistics and reset counters
+     */
+    void report();
+
+public:
+    /**
+     * @brief Sleep handling between frames
+     *
+     * While nothing is animating the WiFi radio is put into light sleep
+     * and the loop only wakes up once there is pending network work or
+     * the next scheduled event (keepalive, statistics) is due.
+     *
+     * @param _hasPendingWork Returns true if the loop should wake up immediately
+     */
+    PowerManager(std::function<bool()> _hasPendingWork)
+    {
+        hasPendingWork = _hasPendingWork;
+    }
+
+    /**
+     * @brief Power setup
+     */
+    void setup();
+
+    /**
+     * @brief Wait for the next frame
+     *
+     * Please call at the end of your main loop.
+     *
+     * @param _mode Power mode for the next frame
+     */
+    void wait(PowerMode _mode);
+};
+
+#endif
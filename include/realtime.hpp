@@ -0,0 +1,130 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+// DDP (Distributed Display Protocol) port
+#define DDP_PORT 4048
+
+// E1.31 (sACN) port
+#define E131_PORT 5568
+
+// First E1.31 universe mapped to the led buffer
+#define E131_START_UNIVERSE 1
+
+// Realtime mode ends after this many ms without packets
+#define REALTIME_TIMEOUT 2500
+
+// Maximum packets processed per loop per protocol
+#define REALTIME_MAX_PACKETS 8
+
+class RealtimeClient
+{
+private:
+    uint8_t *buffer;
+    size_t bufferSize;
+    std::function<void(bool)> onActiveChanged;
+
+    WiFiUDP ddpUdp;
+    WiFiUDP e131Udp;
+
+    // Size of an already parsed but unprocessed packet
+    int ddpPending = 0;
+    int e131Pending = 0;
+
+    bool active = false;
+    unsigned long lastPacket = 0;
+
+    /**
+     * @brief Copy DDP packet payload into led buffer
+     *
+     * @param size Packet size
+     * @return true Frame complete (push flag set)
+     * @return false
+     */
+    bool handleDdp(int size);
+
+    /**
+     * @brief Copy E1.31 packet DMX data into led buffer
+     *
+     * @param size Packet size
+     * @return true Frame complete (last universe received)
+     * @return false
+     */
+    bool handleE131(int size);
+
+public:
+    /**
+     * @brief Realtime pixel input via DDP and E1.31 over UDP
+     *
+     * Pixel data is written directly into the led buffer.
+     *
+     * @param _buffer RGB led buffer
+     * @param _bufferSize Led buffer byte count
+     * @param _onActiveChanged Realtime mode start/stop callback
+     */
+    RealtimeClient(uint8_t *_buffer, size_t _bufferSize, std::function<void(bool)> _onActiveChanged)
+    {
+        buffer = _buffer;
+        bufferSize = _bufferSize;
+        onActiveChanged = _onActiveChanged;
+    }
+
+    /**
+     * @brief Start listening
+     */
+    void setup();
+
+    /**
+     * @brief Process received packets
+     *
+     * Please call inside your main loop.
+     *
+     * @return true A complete frame was written to the led buffer
+     * @return false
+     */
+    bool loop();
+
+    /**
+     * @brief Is a realtime stream active
+     *
+     * @return true
+     * @return false
+     */
+    bool isActive();
+
+    /**
+     * @brief Is a received packet waiting to be processed
+     *
+     * @return true
+     * @return false
+     */
+    bool hasPendingData();
+};
+
+#endif
@@ -0,0 +1,207 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include "color_pipeline.hpp"
+#include "effect_vm.hpp"
+
+/**
+ * @brief Compile-time ws2812b strip descriptor
+ *
+ * A strip is a slice of the shared led buffer driven by one data pin.
+ *
+ * @tparam PIN Data pin
+ * @tparam START First led in the shared buffer
+ * @tparam COUNT Led count
+ */
+template <uint8_t PIN, uint16_t START, uint16_t COUNT>
+class Strip
+{
+public:
+    static constexpr uint8_t pin = PIN;
+    static constexpr uint16_t start = START;
+    static constexpr uint16_t count = COUNT;
+
+    static CLEDController *controller;
+
+    /**
+     * @brief Register strip with FastLED
+     *
+     * @param leds Shared led buffer
+     */
+    template <size_t N>
+    static void add(CRGB (&leds)[N])
+    {
+        static_assert(START + COUNT <= N, "Strip exceeds led buffer");
+        controller = &FastLED.addLeds<WS2812B, PIN, GRB>(leds + START, COUNT);
+    }
+
+    /**
+     * @brief Push strip leds to the hardware
+     */
+    static void show()
+    {
+        controller->showLeds(FastLED.getBrightness());
+    }
+};
+
+template <uint8_t PIN, uint16_t START, uint16_t COUNT>
+CLEDController *Strip<PIN, START, COUNT>::controller = nullptr;
+
+/**
+ * @brief Independently controlled part of a strip
+ *
+ * Holds the light state and renders it into its leds.
+ */
+class Segment
+{
+private:
+    // Rainbow effect current color
+    int effectColorR = 0;
+    int effectColorG = 0;
+    int effectColorB = 0;
+
+    // Pulse effect brightness
+    int effectBrightness = 0;
+    bool effectBrightnessIncrease = true;
+
+    // Uploaded effect program and next pixel to render
+    EffectProgram *program = nullptr;
+    uint16_t programPixel = 0;
+
+    Segment(String _id, String _name, CRGB *_leds, uint16_t _count, void (*_show)())
+    {
+        id = _id;
+        name = _name;
+        leds = _leds;
+        count = _count;
+        show = _show;
+    }
+
+public:
+    String id;
+    String name;
+    CRGB *leds;
+    uint16_t count;
+
+    // Shows the strip this segment belongs to
+    void (*show)();
+
+    // Light state
+    bool on = false;
+    CRGB color = CRGB::White;
+    uint8_t brightness = 255;
+    String effect = "none";
+
+    // Leds need to be rendered and shown
+    bool dirty = true;
+
+    // Output lookup tables for the current brightness
+    ColorLut lut;
+
+    /**
+     * @brief Create segment on a strip
+     *
+     * @tparam STRIP Strip descriptor
+     * @tparam OFFSET First led inside the strip
+     * @tparam COUNT Led count
+     * @param _id Segment id, empty for the main light
+     * @param _name Display name
+     * @param _leds Shared led buffer
+     * @return Segment
+     */
+    template <typename STRIP, uint16_t OFFSET, uint16_t COUNT, size_t N>
+    static Segment of(String _id, String _name, CRGB (&_leds)[N])
+    {
+        static_assert(OFFSET + COUNT <= STRIP::count, "Segment exceeds strip");
+        static_assert(STRIP::start + STRIP::count <= N, "Strip exceeds led buffer");
+        return Segment(_id, _name, _leds + STRIP::start + OFFSET, COUNT, STRIP::show);
+    }
+
+    void setState(bool _on);
+    void setBrightness(uint8_t _brightness);
+    void setColor(uint8_t r, uint8_t g, uint8_t b);
+
+    /**
+     * @brief Change effect
+     *
+     * @param _effect Effect name
+     * @param _program Uploaded effect program or nullptr for built-in effects
+     */
+    void setEffect(const char *_effect, EffectProgram *_program = nullptr);
+
+    /**
+     * @brief Uses this segment the given program
+     *
+     * @param _program Effect program
+     * @return true
+     * @return false
+     */
+    bool usesProgram(EffectProgram *_program);
+
+    /**
+     * @brief Is an effect running on this segment
+     *
+     * @return true
+     * @return false
+     */
+    bool isAnimating();
+
+    /**
+     * @brief Advance running effect by one frame
+     *
+     * @param budget Remaining effect program instructions in this frame
+     */
+    void step(uint32_t &budget);
+
+    /**
+     * @brief Write current state into leds
+     *
+     * Colors are written unscaled, brightness is applied by the color pipeline.
+     */
+    void render();
+
+    /**
+     * @brief Brightness the lookup tables are built for
+     *
+     * @return uint8_t Set brightness, full brightness for the pulse effect
+     */
+    uint8_t outputBrightness();
+
+    /**
+     * @brief Scale applied on top of the lookup tables
+     *
+     * Pulse changes brightness every step, scaling avoids rebuilding the tables.
+     *
+     * @return uint8_t Current pulse effect brightness, 255 otherwise
+     */
+    uint8_t outputScale();
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "color_pipeline.hpp"
+
+ColorPipeline::ColorPipeline(const CRGB *_input, CRGB *_output, uint16_t _count, float _gamma, const uint8_t _calibration[3], bool _dithering)
+{
+    input = _input;
+    output = _output;
+    count = _count;
+    memcpy(calibration, _calibration, sizeof(calibration));
+
+    for (int i = 0; i < 256; i++)
+    {
+        gamma[i] = (uint16_t)(powf(i / 255.0f, _gamma) * 65535.0f + 0.5f);
+    }
+
+    if (_dithering)
+    {
+        error = new uint8_t[count * 3]();
+    }
+}
+
+bool ColorPipeline::isDithering()
+{
+    return error != nullptr;
+}
+
+bool ColorPipeline::isDithering(const ColorLut &lut, uint8_t scale)
+{
+    return error != nullptr && (lut.fractional || scale != 255);
+}
+
+void ColorPipeline::build(ColorLut &lut, uint8_t brightness)
+{
+    uint16_t *tables[3] = {lut.red, lut.green, lut.blue};
+    uint16_t fraction = 0;
+    for (int channel = 0; channel < 3; channel++)
+    {
+        uint32_t scale = calibration[channel] * brightness;
+        for (int i = 0; i < 256; i++)
+        {
+            // Scale 0..65535 to 8.8 fixed point 0..255.0
+            uint32_t value = (uint32_t)gamma[i] * scale / (255 * 255);
+            tables[channel][i] = value * 0xFF00 / 0xFFFF;
+            fraction |= tables[channel][i] & 0xFF;
+        }
+    }
+    lut.brightness = brightness;
+    lut.fractional = fraction != 0;
+}
+
+void ColorPipeline::apply(uint16_t offset, uint16_t length, ColorLut &lut, uint8_t brightness, uint8_t scale)
+{
+    if (lut.brightness != brightness)
+    {
+        build(lut, brightness);
+    }
+
+    const CRGB *in = input + offset;
+    CRGB *out = output + offset;
+
+    if (error == nullptr)
+    {
+        // Round to nearest, table entries never exceed 255.0
+        for (uint16_t i = 0; i < length; i++)
+        {
+            out[i].r = (scale16by8(lut.red[in[i].r], scale) + 0x80) >> 8;
+            out[i].g = (scale16by8(lut.green[in[i].g], scale) + 0x80) >> 8;
+            out[i].b = (scale16by8(lut.blue[in[i].b], scale) + 0x80) >> 8;
+        }
+        return;
+    }
+
+    // Carry the fraction over to the next frame
+    uint8_t *residue = error + offset * 3;
+    for (uint16_t i = 0; i < length; i++)
+    {
+        uint16_t r = scale16by8(lut.red[in[i].r], scale) + residue[0];
+        uint16_t g = scale16by8(lut.green[in[i].g], scale) + residue[1];
+        uint16_t b = scale16by8(lut.blue[in[i].b], scale) + residue[2];
+        out[i].setRGB(r >> 8, g >> 8, b >> 8);
+        residue[0] = r;
+        residue[1] = g;
+        residue[2] = b;
+        residue += 3;
+    }
+}
@@ -0,0 +1,401 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "effect_vm.hpp"
+
+#include <utility>
+
+/**
+ * @brief Stack values consumed and produced by an opcode
+ *
+ * @return false Unknown opcode
+ */
+static bool stackEffect(uint8_t op, int &pops, int &pushes)
+{
+    switch (op)
+    {
+    case OP_PUSH:
+    case OP_TIME:
+    case OP_INDEX:
+    case OP_COUNT:
+    case OP_POS:
+        pops = 0;
+        pushes = 1;
+        return true;
+    case OP_DUP:
+        pops = 1;
+        pushes = 2;
+        return true;
+    case OP_DROP:
+        pops = 1;
+        pushes = 0;
+        return true;
+    case OP_SWAP:
+        pops = 2;
+        pushes = 2;
+        return true;
+    case OP_ADD:
+    case OP_SUB:
+    case OP_MUL:
+    case OP_DIV:
+    case OP_MOD:
+    case OP_MIN:
+    case OP_MAX:
+    case OP_LT:
+        pops = 2;
+        pushes = 1;
+        return true;
+    case OP_NEG:
+    case OP_ABS:
+    case OP_FRAC:
+    case OP_SIN:
+        pops = 1;
+        pushes = 1;
+        return true;
+    case OP_SEL:
+        pops = 3;
+        pushes = 1;
+        return true;
+    case OP_HSV:
+    case OP_RGB:
+        pops = 3;
+        pushes = 0;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Clamp fixed point 0..1 to 0..255
+static inline uint8_t toByte(int32_t value)
+{
+    if (value <= 0)
+    {
+        return 0;
+    }
+    if (value >= VM_ONE)
+    {
+        return 255;
+    }
+    return value >> 8;
+}
+
+bool EffectProgram::load(String _name, const uint8_t *data, size_t length)
+{
+    if (length == 0 || length > VM_MAX_PROGRAM_SIZE)
+    {
+        Serial.printf("Effect '%s' invalid size %u\n", _name.c_str(), length);
+        return false;
+    }
+
+    int depth = 0;
+    uint16_t count = 0;
+    uint8_t lastOp = 0;
+    size_t pc = 0;
+    while (pc < length)
+    {
+        uint8_t op = data[pc];
+        int pops, pushes;
+        if (!stackEffect(op, pops, pushes))
+        {
+            Serial.printf("Effect '%s' unknown opcode 0x%02x at %u\n", _name.c_str(), op, pc);
+            return false;
+        }
+        if (depth < pops)
+        {
+            Serial.printf("Effect '%s' stack underflow at %u\n", _name.c_str(), pc);
+            return false;
+        }
+        depth += pushes - pops;
+        if (depth > VM_STACK_SIZE)
+        {
+            Serial.printf("Effect '%s' stack overflow at %u\n", _name.c_str(), pc);
+            return false;
+        }
+        if (lastOp == OP_HSV || lastOp == OP_RGB)
+        {
+            Serial.printf("Effect '%s' instructions after pixel output at %u\n", _name.c_str(), pc);
+            return false;
+        }
+
+        pc += op == OP_PUSH ? 5 : 1;
+        lastOp = op;
+        count++;
+    }
+
+    if (pc != length)
+    {
+        Serial.printf("Effect '%s' truncated immediate\n", _name.c_str());
+        return false;
+    }
+    if (lastOp != OP_HSV && lastOp != OP_RGB)
+    {
+        Serial.printf("Effect '%s' does not end with pixel output\n", _name.c_str());
+        return false;
+    }
+
+    memcpy(code, data, length);
+    size = length;
+    instructions = count;
+    name = _name;
+    return true;
+}
+
+bool EffectProgram::isLoaded()
+{
+    return size > 0;
+}
+
+void EffectProgram::clear()
+{
+    size = 0;
+    instructions = 0;
+    name = "";
+}
+
+bool EffectProgram::run(CRGB *leds, uint16_t count, uint16_t &nextPixel, uint32_t time, uint32_t &budget)
+{
+    int32_t stack[VM_STACK_SIZE];
+    int32_t seconds = (int32_t)((uint64_t)(time % (VM_TIME_PERIOD * 1000)) * VM_ONE / 1000);
+    int32_t countFixed = (int32_t)count << 16;
+
+    // Programs are validated, so the interpreter needs no bounds checks
+    for (; nextPixel < count; nextPixel++)
+    {
+        if (budget < instructions)
+        {
+            return false;
+        }
+        budget -= instructions;
+
+        int32_t *sp = stack;
+        const uint8_t *pc = code;
+        CRGB color;
+        bool running = true;
+        while (running)
+        {
+            switch (*pc++)
+            {
+            case OP_PUSH:
+                memcpy(sp++, pc, sizeof(int32_t));
+                pc += sizeof(int32_t);
+                break;
+            case OP_TIME:
+                *sp++ = seconds;
+                break;
+            case OP_INDEX:
+                *sp++ = (int32_t)nextPixel << 16;
+                break;
+            case OP_COUNT:
+                *sp++ = countFixed;
+                break;
+            case OP_POS:
+                *sp++ = ((int32_t)nextPixel << 16) / count;
+                break;
+            case OP_DUP:
+                *sp = sp[-1];
+                sp++;
+                break;
+            case OP_DROP:
+                sp--;
+                break;
+            case OP_SWAP:
+                std::swap(sp[-1], sp[-2]);
+                break;
+            case OP_ADD:
+                sp--;
+                sp[-1] = (int32_t)((uint32_t)sp[-1] + (uint32_t)sp[0]);
+                break;
+            case OP_SUB:
+                sp--;
+                sp[-1] = (int32_t)((uint32_t)sp[-1] - (uint32_t)sp[0]);
+                break;
+            case OP_MUL:
+                sp--;
+                sp[-1] = (int32_t)(((int64_t)sp[-1] * sp[0]) >> 16);
+                break;
+            case OP_DIV:
+                sp--;
+                sp[-1] = sp[0] == 0 ? 0 : (int32_t)(((int64_t)sp[-1] << 16) / sp[0]);
+                break;
+            case OP_MOD:
+                sp--;
+                sp[-1] = sp[0] == 0 ? 0 : (int32_t)((int64_t)sp[-1] % sp[0]);
+                break;
+            case OP_MIN:
+                sp--;
+                sp[-1] = min(sp[-1], sp[0]);
+                break;
+            case OP_MAX:
+                sp--;
+                sp[-1] = max(sp[-1], sp[0]);
+                break;
+            case OP_NEG:
+                sp[-1] = (int32_t)(0u - (uint32_t)sp[-1]);
+                break;
+            case OP_ABS:
+                sp[-1] = sp[-1] < 0 ? (int32_t)(0u - (uint32_t)sp[-1]) : sp[-1];
+                break;
+            case OP_FRAC:
+                sp[-1] &= VM_ONE - 1;
+                break;
+            case OP_LT:
+                sp--;
+                sp[-1] = sp[-1] < sp[0] ? VM_ONE : 0;
+                break;
+            case OP_SEL:
+                sp -= 2;
+                sp[-1] = sp[-1] != 0 ? sp[0] : sp[1];
+                break;
+            case OP_SIN:
+                sp[-1] = (int32_t)sin16((uint16_t)sp[-1]) * 2;
+                break;
+            case OP_HSV:
+                sp -= 3;
+                hsv2rgb_rainbow(CHSV((uint8_t)(sp[0] >> 8), toByte(sp[1]), toByte(sp[2])), color);
+                running = false;
+                break;
+            case OP_RGB:
+                sp -= 3;
+                color.setRGB(toByte(sp[0]), toByte(sp[1]), toByte(sp[2]));
+                running = false;
+                break;
+            }
+        }
+
+        leds[nextPixel] = color;
+    }
+
+    nextPixel = 0;
+    return true;
+}
+
+void EffectLibrary::load()
+{
+    uint8_t data[VM_MAX_PROGRAM_SIZE];
+    size_t slot = 0;
+
+    Dir dir = LittleFS.openDir(VM_PROGRAM_DIR);
+    while (dir.next() && slot < VM_MAX_PROGRAMS)
+    {
+        File file = dir.openFile("r");
+        size_t length = file.read(data, sizeof(data));
+        file.close();
+
+        if (programs[slot].load(dir.fileName(), data, length))
+        {
+            Serial.printf("Loaded effect '%s'\n", dir.fileName().c_str());
+            slot++;
+        }
+    }
+}
+
+EffectProgram *EffectLibrary::store(String name, const uint8_t *data, size_t length)
+{
+    if (name.length() == 0 || name.length() > VM_MAX_NAME_LENGTH)
+    {
+        Serial.printf("Effect name '%s' invalid length\n", name.c_str());
+        return nullptr;
+    }
+    for (char c : name)
+    {
+        if (!islower((unsigned char)c) && !isdigit((unsigned char)c) && c != '_')
+        {
+            Serial.printf("Effect name '%s' may only contain a-z, 0-9 and _\n", name.c_str());
+            return nullptr;
+        }
+    }
+
+    String path = String(VM_PROGRAM_DIR "/") + name;
+    EffectProgram *target = find(name.c_str());
+
+    // Empty upload deletes the effect
+    if (length == 0)
+    {
+        if (target != nullptr)
+        {
+            Serial.printf("Deleting effect '%s'\n", name.c_str());
+            target->clear();
+            LittleFS.remove(path);
+        }
+        return target;
+    }
+
+    for (size_t i = 0; i < VM_MAX_PROGRAMS && target == nullptr; i++)
+    {
+        if (!programs[i].isLoaded())
+        {
+            target = &programs[i];
+        }
+    }
+    if (target == nullptr)
+    {
+        Serial.printf("No free effect slot for '%s'\n", name.c_str());
+        return nullptr;
+    }
+
+    // Validate first so that a broken upload keeps the previous version
+    EffectProgram program;
+    if (!program.load(name, data, length))
+    {
+        return nullptr;
+    }
+
+    File file = LittleFS.open(path, "w");
+    if (!file)
+    {
+        Serial.printf("Unable to write effect '%s'\n", path.c_str());
+        return nullptr;
+    }
+    file.write(data, length);
+    file.close();
+
+    *target = program;
+    return target;
+}
+
+EffectProgram *EffectLibrary::find(const char *name)
+{
+    for (EffectProgram &program : programs)
+    {
+        if (program.isLoaded() && program.name == name)
+        {
+            return &program;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<String> EffectLibrary::names()
+{
+    std::vector<String> result;
+    for (EffectProgram &program : programs)
+    {
+        if (program.isLoaded())
+        {
+            result.push_back(program.name);
+        }
+    }
+    return result;
+}
@@ -43,15 +43,29 @@ void HaClient::loop()
         // Connect and set last will
         networkClient->connect(availabilityTopic, 1, false, "offline");
 
-        // Subscribe to topics and send discover message
+        // Subscribe to topics and send discover messages
+        // Commands of all entities are received with wildcard subscriptions
+        bool mainEntity = false;
+        bool segmentEntity = false;
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            mainEntity |= entities[i].id.length() == 0;
+            segmentEntity |= entities[i].id.length() > 0;
+        }
         networkClient->subscribe(haStatusTopic);
-        networkClient->subscribe(commandTopic);
-        networkClient->subscribe(brightnessCommandTopic);
-        networkClient->subscribe(rgbCommandTopic);
-        networkClient->subscribe(effectCommandTopic);
-        networkClient->publish(
-            discoveryTopic,
-            discoveryMessage);
+        if (mainEntity)
+        {
+            networkClient->subscribe(commandSubscription);
+        }
+        if (segmentEntity)
+        {
+            networkClient->subscribe(segmentCommandSubscription);
+        }
+        networkClient->subscribe(programSubscription);
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            publishDiscovery(i);
+        }
 
         // Notify that we are online
         networkClient->publish(
@@ -59,97 +73,266 @@ void HaClient::loop()
             "online");
 
         // Publish current lamp state
-        bool state = getToggleState();
-        networkClient->publish(
-            stateTopic,
-            String(state ? "ON" : "OFF"));
+        publishState();
+    }
 
-        int brightness = getBrightness();
-        networkClient->publish(
-            brightnessStateTopic,
-            String(brightness));
+    // Changes of all entities are published together once per loop
+    flushState();
+}
 
-        int r, g, b;
-        std::tie(r, g, b) = getColor();
-        networkClient->publish(
-            rgbStateTopic,
-            String(String(r) + "," + String(g) + "," + String(b)));
+void HaClient::publishDiscovery(int index)
+{
+    HaEntity &entity = entities[index];
 
-        String effect = getEffect();
-        networkClient->publish(
-            effectStateTopic,
-            effect);
+    DynamicJsonDocument json(2048);
+    json["unique_id"] = entity.uniqueId;
+    json["name"] = entity.name;
+    json["state_topic"] = entity.stateTopic;
+    json["command_topic"] = entity.commandTopic;
+    json["availability_topic"] = availabilityTopic;
+    json["brightness_state_topic"] = entity.brightnessStateTopic;
+    json["brightness_command_topic"] = entity.brightnessCommandTopic;
+    json["rgb_state_topic"] = entity.rgbStateTopic;
+    json["rgb_command_topic"] = entity.rgbCommandTopic;
+    json["effect_state_topic"] = entity.effectStateTopic;
+    json["effect_command_topic"] = entity.effectCommandTopic;
+    JsonArray ports = json.createNestedArray("effect_list");
+    for (String &effect : effects)
+    {
+        ports.add(effect);
     }
+    json["state_value_template"] = "{{ value_json.state }}";
+    json["availability_template"] = "{{ value }}";
+    json["brightness_value_template"] = "{{ value_json.brightness }}";
+    json["rgb_value_template"] = "{{ value_json.rgb | join(',') }}";
+    json["effect_command_template"] = "{{ value }}";
+    json["qos"] = 0;
+    json["payload_on"] = "ON";
+    json["payload_off"] = "OFF";
+    json["optimistic"] = true;
+
+    // Group all entities of this lamp
+    JsonObject device = json.createNestedObject("device");
+    device["identifiers"] = config->mqttHaUniqueId;
+    device["name"] = "Ikea Iskaerna Smart";
+
+    networkClient->publish(
+        entity.discoveryTopic,
+        json);
+}
+
+void HaClient::setEffects(std::vector<String> _effects)
+{
+    effects = _effects;
+    if (networkClient->isConnected())
+    {
+        for (size_t i = 0; i < entities.size(); i++)
+        {
+            publishDiscovery(i);
+        }
+    }
+}
+
+void HaClient::publishState()
+{
+    for (HaEntity &entity : entities)
+    {
+        entity.pendingState = HA_STATE_ALL;
+    }
+}
+
+void HaClient::flushState()
+{
+    if (!networkClient->isConnected())
+    {
+        return;
+    }
+
+    // Formatted without String temporaries to avoid heap churn
+    char payload[16];
+    for (size_t i = 0; i < entities.size(); i++)
+    {
+        HaEntity &entity = entities[i];
+        if (entity.pendingState == 0)
+        {
+            continue;
+        }
+
+        if (entity.pendingState & HA_STATE_SWITCH)
+        {
+            bool state = getToggleState(i);
+            networkClient->publish(
+                entity.stateTopic,
+                state ? "ON" : "OFF");
+        }
+
+        if (entity.pendingState & HA_STATE_BRIGHTNESS)
+        {
+            snprintf(payload, sizeof(payload), "%d", getBrightness(i));
+            networkClient->publish(
+                entity.brightnessStateTopic,
+                payload);
+        }
+
+        if (entity.pendingState & HA_STATE_RGB)
+        {
+            int r, g, b;
+            std::tie(r, g, b) = getColor(i);
+            snprintf(payload, sizeof(payload), "%d,%d,%d", r, g, b);
+            networkClient->publish(
+                entity.rgbStateTopic,
+                payload);
+        }
+
+        if (entity.pendingState & HA_STATE_EFFECT)
+        {
+            networkClient->publish(
+                entity.effectStateTopic,
+                getEffect(i));
+        }
+
+        entity.pendingState = 0;
+    }
+}
+
+bool HaClient::hasPendingWork()
+{
+    return !networkClient->isConnected() || networkClient->hasPendingData();
+}
+
+bool HaClient::isTopicSafe(const String &id)
+{
+    if (id.length() == 0)
+    {
+        return false;
+    }
+    for (char c : id)
+    {
+        if (!isalnum((unsigned char)c) && c != '_' && c != '-')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int HaClient::findEntity(const char *id, size_t length)
+{
+    for (size_t i = 0; i < entities.size(); i++)
+    {
+        if (entities[i].id.length() == length && strncmp(entities[i].id.c_str(), id, length) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Compare a not null terminated topic segment
+static bool segmentEquals(const char *segment, size_t length, const char *value)
+{
+    return strlen(value) == length && strncmp(segment, value, length) == 0;
 }
 
 void HaClient::mqttCallback(char *topic, byte *payload, unsigned int length)
 {
+    // Effect program upload, payload is bytecode
+    if (strncmp(topic, programTopic.c_str(), programTopic.length()) == 0)
+    {
+        Serial.printf("mqttCallback %s received %d bytes program\n", topic, length);
+        onUploadEffect(String(topic + programTopic.length()), payload, length);
+        return;
+    }
+
     Serial.printf("mqttCallback %s received %d bytes payload: %.*s\n", topic, length, length, payload);
-    char payloadStringBuff[length + 1] = "";
-    strncpy(payloadStringBuff, (const char *)payload, length);
-    payloadStringBuff[length] = '\0';
-    String topicString = String(topic);
-    String payloadString = String(payloadStringBuff);
+    if (length > HA_MAX_PAYLOAD_SIZE)
+    {
+        return;
+    }
+    char payloadString[HA_MAX_PAYLOAD_SIZE + 1];
+    memcpy(payloadString, payload, length);
+    payloadString[length] = '\0';
 
     // Home Assistant birth message. Resend device discovery
-    if (topicString == haStatusTopic && payloadString == "online")
+    if (haStatusTopic == topic)
     {
-        Serial.printf("HA is online again\n");
-        networkClient->publish(
-            discoveryTopic,
-            discoveryMessage);
+        if (strcmp(payloadString, "online") == 0)
+        {
+            Serial.printf("HA is online again\n");
+            for (size_t i = 0; i < entities.size(); i++)
+            {
+                publishDiscovery(i);
+            }
+        }
+        return;
     }
-    // Request lamp turn on
-    else if (topicString == commandTopic && payloadString == "ON")
+
+    // Commands follow <prefix>/[<entity id>/]<field>/set
+    size_t prefixLength = topicPrefix.length();
+    if (strncmp(topic, topicPrefix.c_str(), prefixLength) != 0 || topic[prefixLength] != '/')
     {
-        onToggleState(true);
-        networkClient->publish(
-            stateTopic,
-            String("ON"));
+        return;
     }
-    // Request lamp turn off
-    else if (topicString == commandTopic && payloadString == "OFF")
+    const char *path = topic + prefixLength + 1;
+    const char *end = strrchr(path, '/');
+    if (end == NULL || strcmp(end, "/set") != 0)
     {
-        onToggleState(false);
-        networkClient->publish(
-            stateTopic,
-            String("OFF"));
+        return;
+    }
+
+    // Field is the segment in front of /set, anything before is the entity id
+    const char *field = end;
+    while (field > path && field[-1] != '/')
+    {
+        field--;
+    }
+    size_t fieldLength = end - field;
+    int index = findEntity(path, field > path ? field - path - 1 : 0);
+    if (index < 0)
+    {
+        return;
+    }
+    HaEntity &entity = entities[index];
+
+    // Request lamp turn on or off
+    if (segmentEquals(field, fieldLength, "state"))
+    {
+        bool on = strcmp(payloadString, "ON") == 0;
+        if (on || strcmp(payloadString, "OFF") == 0)
+        {
+            onToggleState(index, on);
+            entity.pendingState |= HA_STATE_SWITCH;
+        }
     }
     // Alter brightness
-    else if (topicString == brightnessCommandTopic)
+    else if (segmentEquals(field, fieldLength, "brightness"))
     {
-        int brightness = atoi(payloadString.c_str());
-        onSetBrightness(brightness);
-        networkClient->publish(
-            brightnessStateTopic,
-            String(payloadString));
+        int brightness = atoi(payloadString);
+        onSetBrightness(index, brightness);
+        entity.pendingState |= HA_STATE_BRIGHTNESS;
     }
     // Change rbg color
-    else if (topicString == rgbCommandTopic)
+    else if (segmentEquals(field, fieldLength, "rgb"))
     {
         // Rgb payload is following format: 25,44,255
-        char *strings[3];
+        int rgb[3] = {0, 0, 0};
         char *ptr = NULL;
-        byte index = 0;
-        ptr = strtok((char *)payloadString.c_str(), ",");
-        while (ptr != NULL)
+        byte i = 0;
+        ptr = strtok(payloadString, ",");
+        while (ptr != NULL && i < 3)
         {
-            strings[index] = ptr;
-            index++;
+            rgb[i] = atoi(ptr);
+            i++;
             ptr = strtok(NULL, ",");
         }
 
-        int r = atoi(strings[0]);
-        int g = atoi(strings[1]);
-        int b = atoi(strings[2]);
-        onSetColor(r, g, b);
-        networkClient->publish(
-            rgbStateTopic,
-            String(payloadString));
+        onSetColor(index, rgb[0], rgb[1], rgb[2]);
+        entity.pendingState |= HA_STATE_RGB;
     }
     // Change current effect
-    else if (topicString == effectCommandTopic)
+    else if (segmentEquals(field, fieldLength, "effect"))
     {
-        onSetEffect(String(payloadString));
+        onSetEffect(index, payloadString);
+        entity.pendingState |= HA_STATE_EFFECT;
     }
-}
\ No newline at end of file
+}
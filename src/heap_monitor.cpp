@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "heap_monitor.hpp"
+
+void HeapMonitor::setup()
+{
+    lastSample = millis();
+    windowStart = lastSample;
+    sample();
+}
+
+void HeapMonitor::loop()
+{
+    unsigned long now = millis();
+    if (now - lastSample < HEAP_SAMPLE_INTERVAL)
+    {
+        return;
+    }
+    lastSample = now;
+    sample();
+
+    if (now - windowStart >= HEAP_WINDOW_LENGTH)
+    {
+        windowStart = now;
+        report();
+    }
+}
+
+void HeapMonitor::sample()
+{
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t freeBlock = ESP.getMaxFreeBlockSize();
+    uint8_t fragmentation = ESP.getHeapFragmentation();
+
+    minFreeHeap = min(minFreeHeap, freeHeap);
+    minFreeBlock = min(minFreeBlock, freeBlock);
+    maxFragmentation = max(maxFragmentation, fragmentation);
+
+    if (freeBlock < HEAP_MIN_FREE_BLOCK && !lowBlockReported)
+    {
+        Serial.printf("Heap warning: largest free block %u below %u bytes\n", freeBlock, HEAP_MIN_FREE_BLOCK);
+        lowBlockReported = true;
+    }
+    else if (freeBlock >= HEAP_MIN_FREE_BLOCK)
+    {
+        lowBlockReported = false;
+    }
+}
+
+void HeapMonitor::report()
+{
+    Serial.printf("Heap: free %u (min %u), largest block %u (min %u), fragmentation %u%% (max %u%%)\n",
+                  ESP.getFreeHeap(),
+                  minFreeHeap,
+                  ESP.getMaxFreeBlockSize(),
+                  minFreeBlock,
+                  ESP.getHeapFragmentation(),
+                  maxFragmentation);
+
+    // A lower minimum in every window hints at a leak
+    if (lastWindowFreeHeap != UINT32_MAX && minFreeHeap < lastWindowFreeHeap)
+    {
+        shrinkingWindows++;
+    }
+    else
+    {
+        shrinkingWindows = 0;
+    }
+    if (shrinkingWindows >= HEAP_LEAK_WINDOWS)
+    {
+        Serial.printf("Heap warning: minimum free heap shrinking for %d windows, possible leak\n", shrinkingWindows);
+    }
+
+    lastWindowFreeHeap = minFreeHeap;
+    minFreeHeap = UINT32_MAX;
+    minFreeBlock = UINT32_MAX;
+    maxFragmentation = 0;
+}
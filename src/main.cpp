@@ -24,105 +24,229 @@
 
 #include "LittleFS.h"
 #include <FastLED.h>
+#include <algorithm>
 #include <tuple>
+#include <vector>
 
+#include "color_pipeline.hpp"
 #include "config.hpp"
+#include "effect_vm.hpp"
 #include "ha_client.hpp"
+#ifdef HEAP_MONITOR
+#include "heap_monitor.hpp"
+#endif
+#include "power.hpp"
+#include "realtime.hpp"
+#include "segment.hpp"
 
-// Number of ws2812b leds
+// Number of ws2812b leds over all strips
 #define NUM_LEDS 6
 
 // LED data pin
 #define DATA_PIN 5
 
-// Temporary color store to save latest color information
-// once the lamp turns off/on
-CRGB savedColor;
+// Effects advance at this interval independent of the loop rate
+#define EFFECT_STEP_INTERVAL ACTIVE_FRAME_DELAY
 
-// Current LED colors
+// Current LED colors of all strips
 CRGB leds[NUM_LEDS];
 
-// Active effect
-String currentEffect = "none";
+// LED colors after gamma, calibration and brightness, sent to the strips
+CRGB outputLeds[NUM_LEDS];
 
-//  Rainbow effect current color
-int effectColorR = 0;
-int effectColorG = 0;
-int effectColorB = 0;
+// Strips as slices of leds. Add further strips with their own data pin, e.g.
+// typedef Strip<4, 6, 30> ShelfStrip;
+typedef Strip<DATA_PIN, 0, NUM_LEDS> LampStrip;
 
-// Pulse effect brightness
-int effectBrightness = 0;
-bool effectBrightnessIncrease = true;
+// Segments, each one is exposed as Home Assistant light. The main light uses an empty id.
+// Split a strip into further segments, e.g.
+// Segment::of<ShelfStrip, 0, 15>("left", "Shelf Left", leds)
+Segment segments[] = {
+    Segment::of<LampStrip, 0, NUM_LEDS>("", "Ikea Iskaerna Smart", leds)};
+
+#define NUM_SEGMENTS (sizeof(segments) / sizeof(segments[0]))
+
+// Built-in effects
+const std::vector<String> builtinEffects = {"none", "rainbow", "pulse", "realtime"};
+
+// Uploaded effect programs
+EffectLibrary effectLibrary;
 
 // Home Assistant client
 HaClient *client;
 
-// Getter functions for current lamp state
-bool getToggleState()
+// Idle sleep handling
+PowerManager *power;
+
+// Output stage
+ColorPipeline *pipeline;
+
+// Last effect step
+unsigned long lastEffectStep = 0;
+
+// Segment that draws first on the effect program budget
+size_t firstSegment = 0;
+
+#ifdef HEAP_MONITOR
+// Heap and fragmentation statistics
+HeapMonitor heapMonitor;
+#endif
+
+// Optional DDP/E1.31 input
+RealtimeClient *realtime = nullptr;
+
+// Getter functions for current segment state
+bool getToggleState(int segment)
 {
-  return leds[0] != CRGB::Black;
+  return segments[segment].on;
 }
 
-int getBrightness()
+int getBrightness(int segment)
 {
-  return FastLED.getBrightness();
+  return segments[segment].brightness;
 }
 
-std::tuple<int, int, int> getColor()
+std::tuple<int, int, int> getColor(int segment)
 {
-  return std::make_tuple(leds[0].r, leds[0].g, leds[0].b);
+  CRGB color = segments[segment].color;
+  return std::make_tuple(color.r, color.g, color.b);
 }
 
-String getEffect()
+const char *getEffect(int segment)
 {
-  return currentEffect;
+  if (realtime != nullptr && realtime->isActive())
+  {
+    return "realtime";
+  }
+  return segments[segment].effect.c_str();
 }
 
-// Callback functions to alter current lamp state
-void onToggleState(bool state)
+// Callback functions to alter current segment state
+void onToggleState(int segment, bool state)
 {
-  Serial.printf("Toggle lamp state to %d\n", state);
-  CRGB target = state ? savedColor : CRGB::Black;
+  Serial.printf("Toggle segment '%s' state to %d\n", segments[segment].id.c_str(), state);
+  segments[segment].setState(state);
+}
 
-  if (!state)
+void onSetBrightness(int segment, int brightness)
+{
+  segments[segment].setBrightness(brightness);
+}
+
+void onSetColor(int segment, int r, int g, int b)
+{
+  segments[segment].setColor(r, g, b);
+}
+
+void onSetEffect(int segment, const char *effect)
+{
+  // Realtime mode is entered by streaming and can not be selected
+  if (strcmp(effect, "realtime") == 0)
   {
-    savedColor = leds[0];
+    return;
   }
-  for (int i = 0; i < NUM_LEDS; i++)
+
+  // Unknown names would keep the loop animating a static color. The current
+  // effect is published back instead
+  EffectProgram *program = effectLibrary.find(effect);
+  if (program == nullptr && std::find(builtinEffects.begin(), builtinEffects.end(), effect) == builtinEffects.end())
   {
-    leds[i] = target;
+    Serial.printf("Unknown effect '%s'\n", effect);
+    return;
   }
+
+  segments[segment].setEffect(effect, program);
 }
 
-void onSetBrightness(int brightness)
+// Built-in and uploaded effects
+std::vector<String> getEffectList()
 {
-  FastLED.setBrightness(brightness);
+  std::vector<String> effects = builtinEffects;
+  for (String &name : effectLibrary.names())
+  {
+    effects.push_back(name);
+  }
+  return effects;
 }
 
-void onSetColor(int r, int g, int b)
+void onUploadEffect(String name, const uint8_t *data, unsigned int length)
 {
-  savedColor.setRGB(r, g, b);
-  for (int i = 0; i < NUM_LEDS; i++)
+  if (std::find(builtinEffects.begin(), builtinEffects.end(), name) != builtinEffects.end())
   {
-    leds[i].setRGB(r, g, b);
+    Serial.printf("Effect '%s' is built-in\n", name.c_str());
+    return;
   }
+
+  EffectProgram *program = effectLibrary.store(name, data, length);
+  if (program == nullptr)
+  {
+    return;
+  }
+
+  // Segments keep running a replaced program, deleted ones fall back to none
+  for (Segment &segment : segments)
+  {
+    if (segment.usesProgram(program))
+    {
+      segment.setEffect(program->isLoaded() ? name.c_str() : "none", program->isLoaded() ? program : nullptr);
+      client->publishState();
+    }
+  }
+  client->setEffects(getEffectList());
+}
+
+void onRealtimeActiveChanged(bool active)
+{
+  // Segments take over again once the stream stopped
+  if (!active)
+  {
+    for (Segment &segment : segments)
+    {
+      segment.dirty = true;
+    }
+  }
+  client->publishState();
 }
 
-void onSetEffect(String effect)
+// Convert segment leds into the output buffer
+void output(Segment &segment)
 {
-  currentEffect = effect;
-  if (currentEffect == "rainbow")
+  pipeline->apply(segment.leds - leds, segment.count, segment.lut, segment.outputBrightness(), segment.outputScale());
+}
+
+// Render changed segments and show every affected strip once
+void render()
+{
+  for (Segment &segment : segments)
+  {
+    if (segment.dirty)
+    {
+      segment.render();
+      output(segment);
+    }
+  }
+
+  for (size_t i = 0; i < NUM_SEGMENTS; i++)
   {
-    Serial.printf("Starting effect %s\n", effect.c_str());
-    effectColorR = leds[0].r;
-    effectColorG = leds[0].g;
-    effectColorB = leds[0].b;
+    if (!segments[i].dirty)
+    {
+      continue;
+    }
+
+    bool shown = false;
+    for (size_t j = 0; j < i && !shown; j++)
+    {
+      shown = segments[j].dirty && segments[j].show == segments[i].show;
+    }
+    if (!shown)
+    {
+      segments[i].show();
+    }
   }
-  else if (currentEffect == "pulse")
+
+  for (Segment &segment : segments)
   {
-    Serial.printf("Starting effect %s\n", effect.c_str());
-    effectBrightness = FastLED.getBrightness();
-    effectBrightnessIncrease = false;
+    segment.dirty = false;
   }
 }
 
@@ -132,78 +256,113 @@ void setup()
   Serial.begin(9600);
   delay(500);
 
-  // Setup FastLED
-  FastLED.addLeds<WS2812B, DATA_PIN, GRB>(leds, NUM_LEDS);
-  savedColor = CRGB::White;
-  for (int i = 0; i < NUM_LEDS; i++)
-  {
-    // Initially all LEDs are off
-    leds[i] = CRGB::Black;
-  }
+  // Setup FastLED. Initially all LEDs are off
+  LampStrip::add(outputLeds);
   FastLED.show();
 
-  // Load config and setup Home Assistant client
+  // Load config and setup output stage
   Config *config = Config::load("/config.json");
-  client = new HaClient(config, getToggleState, getBrightness, getColor, getEffect, onToggleState, onSetBrightness, onSetColor, onSetEffect);
+  pipeline = new ColorPipeline(leds, outputLeds, NUM_LEDS, config->gamma, config->colorCalibration, config->dithering);
+  render();
+
+  // Setup effect programs and Home Assistant client
+  effectLibrary.load();
+  std::vector<HaEntity> entities;
+  for (Segment &segment : segments)
+  {
+    entities.push_back(HaEntity(segment.id, segment.name));
+  }
+  client = new HaClient(config, entities, getToggleState, getBrightness, getColor, getEffect, onToggleState, onSetBrightness, onSetColor, onSetEffect, onUploadEffect);
   client->setup();
+  client->setEffects(getEffectList());
+
+  if (config->realtimeEnabled)
+  {
+    realtime = new RealtimeClient((uint8_t *)leds, sizeof(leds), onRealtimeActiveChanged);
+    realtime->setup();
+  }
+
+  power = new PowerManager([]()
+                           { return client->hasPendingWork() || (realtime != nullptr && realtime->hasPendingData()); });
+  power->setup();
+
+#ifdef HEAP_MONITOR
+  heapMonitor.setup();
+#endif
 }
 
 void loop()
 {
-  // Rainbow effect is enabled
-  if (currentEffect == "rainbow")
+  // Loop client first so that commands are shown within the same frame
+  client->loop();
+
+  // Realtime input has priority over effects while packets arrive
+  bool streaming = false;
+  if (realtime != nullptr)
   {
-    // Apply color
-    for (int i = 0; i < NUM_LEDS; i++)
-    {
-      leds[i].setRGB(effectColorR, effectColorG, effectColorB);
-    }
-    // There is probably a better way to rotate through all rgb colors like using hsv
-    if (effectColorR == 255 && effectColorG < 255 && effectColorB == 0)
+    if (realtime->loop())
     {
-      effectColorG++;
-    }
-    else if (effectColorR > 0 && effectColorG == 255 && effectColorB == 0)
-    {
-      effectColorR--;
-    }
-    else if (effectColorR == 0 && effectColorG == 255 && effectColorB < 255)
-    {
-      effectColorB++;
-    }
-    else if (effectColorR == 0 && effectColorG > 0 && effectColorB == 255)
-    {
-      effectColorG--;
-    }
-    else if (effectColorR < 255 && effectColorG == 0 && effectColorB == 255)
-    {
-      effectColorR++;
-    }
-    else if (effectColorR == 255 && effectColorG == 0 && effectColorB > 0)
-    {
-      effectColorB--;
+      for (Segment &segment : segments)
+      {
+        output(segment);
+      }
+      FastLED.show();
     }
+    streaming = realtime->isActive();
   }
-  // Pulse effect is enabled
-  else if (currentEffect == "pulse")
+
+  bool animating = false;
+  bool dithering = false;
+  if (!streaming)
   {
-    if (effectBrightness == 0)
+    // Effect programs share one instruction budget per frame. The first
+    // segment rotates so that an expensive program can not starve the others
+    bool step = millis() - lastEffectStep >= EFFECT_STEP_INTERVAL;
+    uint32_t budget = VM_FRAME_BUDGET;
+    for (size_t i = 0; i < NUM_SEGMENTS; i++)
     {
-      effectBrightnessIncrease = true;
+      Segment &segment = segments[(firstSegment + i) % NUM_SEGMENTS];
+      if (segment.isAnimating())
+      {
+        animating = true;
+        if (step)
+        {
+          segment.step(budget);
+        }
+      }
+
+      // Dithering needs every frame shown while the light is on and the
+      // output has fractional bits to spread
+      if (segment.on && pipeline->isDithering(segment.lut, segment.outputScale()))
+      {
+        dithering = true;
+        segment.dirty = true;
+      }
     }
-    else if (effectBrightness == 255)
+    if (step)
     {
-      effectBrightnessIncrease = false;
+      lastEffectStep = millis();
+      firstSegment = (firstSegment + 1) % NUM_SEGMENTS;
     }
-    effectBrightness = effectBrightness + (effectBrightnessIncrease ? 3 : -3);
-    FastLED.setBrightness(effectBrightness);
+    render();
   }
 
-  // Apply fastled changes
-  FastLED.show();
-
-  // Loop client
-  client->loop();
-
-  delay(50);
+  // Sleep until next frame. Radio sleeps while nothing is animating
+  PowerMode mode = POWER_IDLE;
+  if (streaming)
+  {
+    mode = POWER_REALTIME;
+  }
+  else if (dithering)
+  {
+    mode = POWER_DITHER;
+  }
+  else if (animating)
+  {
+    mode = POWER_ACTIVE;
+  }
+#ifdef HEAP_MONITOR
+  heapMonitor.loop();
+#endif
+  power->wait(mode);
 }
\ No newline at end of file
@@ -26,6 +26,10 @@
 #include <Arduino.h>
 #include <ESP8266WiFi.h>
 #include <PubSubClient.h>
+#include <StackThunk.h>
+#include <memory>
+#include <time.h>
+#include <umm_malloc/umm_malloc.h>
 
 void NetworkClient::setup()
 {
@@ -33,15 +37,96 @@ void NetworkClient::setup()
     Serial.printf("Running WiFi setup\n");
     WiFi.mode(WIFI_STA);
 
+    if (config->mqttTls)
+    {
+        setupTls();
+        wifiClient = secureClient;
+    }
+    else
+    {
+        wifiClient = new WiFiClient();
+    }
+
     Serial.printf("Running MQTT setup\n");
 
-    mqttClient = new PubSubClient(wifiClient);
+    mqttClient = new PubSubClient(*wifiClient);
     mqttClient->setBufferSize(MQTT_PACKET_BUFFER_SIZE);
     mqttClient->setServer(config->mqttServer.c_str(), config->mqttPort);
     mqttClient->setCallback(callback);
 }
 
-void NetworkClient::connect(String willTopic, uint8_t willQos, boolean willRetain, String willMessage)
+void NetworkClient::setupTls()
+{
+    Serial.printf("Running TLS setup\n");
+    secureClient = new BearSSL::WiFiClientSecure();
+
+    // Reuse session parameters on reconnect instead of a full handshake
+    secureClient->setSession(&tlsSession);
+
+    if (config->mqttTlsFingerprint.length() > 0)
+    {
+        Serial.printf("TLS using pinned fingerprint\n");
+        secureClient->setFingerprint(config->mqttTlsFingerprint.c_str());
+        return;
+    }
+
+    File file = LittleFS.open(config->mqttTlsCaFile, "r");
+    if (!file)
+    {
+        Serial.printf("TLS enabled but no fingerprint or CA file '%s' found\n", config->mqttTlsCaFile.c_str());
+        for (;;)
+        {
+            delay(100);
+        }
+    }
+
+    String pem = file.readString();
+    file.close();
+    trustAnchors = new BearSSL::X509List(pem.c_str());
+    Serial.printf("TLS using %d trust anchors from %s\n", trustAnchors->getCount(), config->mqttTlsCaFile.c_str());
+    secureClient->setTrustAnchors(trustAnchors);
+}
+
+void NetworkClient::prepareTls()
+{
+    if (tlsBuffersConfigured)
+    {
+        return;
+    }
+
+    // Certificate validity dates require the current time
+    if (trustAnchors != nullptr && time(nullptr) < 8 * 3600 * 2)
+    {
+        configTime(0, 0, TLS_NTP_SERVER);
+        unsigned long start = millis();
+        while (time(nullptr) < 8 * 3600 * 2 && millis() - start < TLS_NTP_TIMEOUT)
+        {
+            delay(100);
+        }
+    }
+
+    // Shrink receive buffer if the broker supports max fragment length negotiation
+    bool mfln = BearSSL::WiFiClientSecure::probeMaxFragmentLength(config->mqttServer, config->mqttPort, TLS_FRAGMENT_LENGTH);
+    secureClient->setBufferSizes(mfln ? TLS_FRAGMENT_LENGTH : TLS_DEFAULT_RX_BUFFER_SIZE, TLS_FRAGMENT_LENGTH);
+    if (mfln)
+    {
+        Serial.printf("TLS max fragment length %d supported\n", TLS_FRAGMENT_LENGTH);
+        tlsBuffersConfigured = true;
+        return;
+    }
+
+    // A failed probe can also mean the broker is unreachable. Only keep the
+    // large buffer for good if the broker accepts connections, else probe again
+    WiFiClient probe;
+    if (probe.connect(config->mqttServer.c_str(), config->mqttPort))
+    {
+        Serial.printf("TLS max fragment length %d not supported\n", TLS_FRAGMENT_LENGTH);
+        tlsBuffersConfigured = true;
+    }
+    probe.stop();
+}
+
+void NetworkClient::connect(const String &willTopic, uint8_t willQos, boolean willRetain, const char *willMessage)
 {
     // Connect to wifi if not connected
     if (WiFi.status() != WL_CONNECTED)
@@ -61,9 +146,20 @@ void NetworkClient::connect(String willTopic, uint8_t willQos, boolean willRetai
     {
         Serial.printf("MQTT Connecting to %s:%d\n", config->mqttServer.c_str(), config->mqttPort);
 
+        if (secureClient != nullptr)
+        {
+            prepareTls();
+        }
+
         // Loop until we are connected
         while (!mqttClient->connected())
         {
+            uint32_t heapBefore = ESP.getFreeHeap();
+            unsigned long connectStart = millis();
+
+            // Low water mark of free heap during the handshake
+            umm_free_heap_size_min_reset();
+
             // Connect
             if (mqttClient->connect(
                     config->mqttServer.c_str(),
@@ -72,13 +168,30 @@ void NetworkClient::connect(String willTopic, uint8_t willQos, boolean willRetai
                     willTopic.c_str(),
                     willQos,
                     willRetain,
-                    willMessage.c_str()))
+                    willMessage))
             {
                 Serial.printf("MQTT connected\n");
+                if (secureClient != nullptr)
+                {
+                    uint32_t heapMin = umm_free_heap_size_min();
+                    Serial.printf("TLS handshake %lums, heap before %u after %u min %u (peak use %u), max BearSSL stack %u\n",
+                                  millis() - connectStart,
+                                  heapBefore,
+                                  ESP.getFreeHeap(),
+                                  heapMin,
+                                  heapBefore - heapMin,
+                                  stack_thunk_get_max_usage());
+                }
             }
             else
             {
                 Serial.printf("Mqtt connection failed. state: %d retring after 5s\n", mqttClient->state());
+                if (secureClient != nullptr)
+                {
+                    char error[64];
+                    secureClient->getLastSSLError(error, sizeof(error));
+                    Serial.printf("TLS error: %s\n", error);
+                }
                 delay(5000);
             }
         }
@@ -87,7 +200,12 @@ void NetworkClient::connect(String willTopic, uint8_t willQos, boolean willRetai
 
 bool NetworkClient::isConnected()
 {
-    return WiFi.status() == WL_CONNECTED && mqttClient->connected();
+    return mqttClient != nullptr && WiFi.status() == WL_CONNECTED && mqttClient->connected();
+}
+
+bool NetworkClient::hasPendingData()
+{
+    return wifiClient->available() > 0;
 }
 
 void NetworkClient::loop()
@@ -95,12 +213,22 @@ void NetworkClient::loop()
     mqttClient->loop();
 }
 
-void NetworkClient::subscribe(String topic)
+void NetworkClient::subscribe(const String &topic)
 {
     mqttClient->subscribe(topic.c_str());
 }
 
-void NetworkClient::publish(String topic, String payload)
+void NetworkClient::publish(const String &topic, const char *payload)
+{
+    mqttClient->publish(topic.c_str(), payload);
+}
+
+void NetworkClient::publish(const String &topic, JsonDocument &json)
 {
-    mqttClient->publish(topic.c_str(), payload.c_str());
+    // One exact size buffer instead of a growing String. Also keeps TLS
+    // from sending a record per character
+    size_t length = measureJson(json);
+    std::unique_ptr<uint8_t[]> payload(new uint8_t[length + 1]);
+    serializeJson(json, payload.get(), length + 1);
+    mqttClient->publish(topic.c_str(), payload.get(), length);
 }
\ No newline at end of file
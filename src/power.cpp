@@ -0,0 +1,124 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "power.hpp"
+
+void PowerManager::setup()
+{
+    frameStart = millis();
+    lastReport = frameStart;
+}
+
+void PowerManager::setMode(PowerMode _mode)
+{
+    if (mode == _mode)
+    {
+        return;
+    }
+
+    mode = _mode;
+    if (mode == POWER_IDLE)
+    {
+        WiFi.setSleepMode(WIFI_LIGHT_SLEEP, IDLE_LISTEN_INTERVAL);
+    }
+    else if (mode == POWER_ACTIVE || mode == POWER_DITHER)
+    {
+        WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+    }
+    else
+    {
+        WiFi.setSleepMode(WIFI_NONE_SLEEP);
+    }
+}
+
+void PowerManager::wait(PowerMode _mode)
+{
+    unsigned long now = millis();
+    busyTime += now - frameStart;
+    setMode(_mode);
+
+    if (mode != POWER_IDLE)
+    {
+        if (mode == POWER_REALTIME)
+        {
+            delay(REALTIME_FRAME_DELAY);
+        }
+        else if (mode == POWER_DITHER)
+        {
+            delay(DITHER_FRAME_DELAY);
+        }
+        else
+        {
+            delay(ACTIVE_FRAME_DELAY);
+        }
+        activeSleepTime += millis() - now;
+        activeFrames++;
+    }
+    else
+    {
+        // Sleep until the next scheduled event unless a command arrives
+        unsigned long deadline = now + IDLE_MAX_SLEEP;
+        if ((long)(lastReport + POWER_STATS_INTERVAL - deadline) < 0)
+        {
+            deadline = lastReport + POWER_STATS_INTERVAL;
+        }
+        while ((long)(deadline - millis()) > 0 && !hasPendingWork())
+        {
+            delay(IDLE_POLL_INTERVAL);
+        }
+        idleSleepTime += millis() - now;
+        idleFrames++;
+    }
+
+    frameStart = millis();
+    if (frameStart - lastReport >= POWER_STATS_INTERVAL)
+    {
+        report();
+    }
+}
+
+void PowerManager::report()
+{
+    unsigned long total = busyTime + activeSleepTime + idleSleepTime;
+    if (total == 0)
+    {
+        return;
+    }
+
+    Serial.printf("Power: busy %lums (%lu.%lu%%), active sleep %lums, idle sleep %lums, frames active %lu idle %lu\n",
+                  busyTime,
+                  busyTime * 100 / total,
+                  busyTime * 1000 / total % 10,
+                  activeSleepTime,
+                  idleSleepTime,
+                  activeFrames,
+                  idleFrames);
+
+    lastReport = frameStart;
+    busyTime = 0;
+    activeSleepTime = 0;
+    idleSleepTime = 0;
+    activeFrames = 0;
+    idleFrames = 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "realtime.hpp"
+
+// DDP header layout
+#define DDP_HEADER_SIZE 10
+#define DDP_TIMECODE_SIZE 4
+#define DDP_FLAG_VERSION_MASK 0xC0
+#define DDP_FLAG_VERSION_1 0x40
+#define DDP_FLAG_TIMECODE 0x10
+#define DDP_FLAG_PUSH 0x01
+#define DDP_ID_DISPLAY 1
+
+// E1.31 header layout
+#define E131_HEADER_SIZE 126
+#define E131_UNIVERSE_CHANNELS 510
+
+static const uint8_t e131AcnId[] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+
+void RealtimeClient::setup()
+{
+    Serial.printf("Realtime input listening on DDP port %d and E1.31 port %d\n", DDP_PORT, E131_PORT);
+    ddpUdp.begin(DDP_PORT);
+    e131Udp.begin(E131_PORT);
+}
+
+bool RealtimeClient::loop()
+{
+    bool frame = false;
+
+    for (int i = 0; i < REALTIME_MAX_PACKETS; i++)
+    {
+        if (ddpPending == 0)
+        {
+            ddpPending = ddpUdp.parsePacket();
+        }
+        if (ddpPending == 0)
+        {
+            break;
+        }
+        frame |= handleDdp(ddpPending);
+        ddpPending = 0;
+    }
+
+    for (int i = 0; i < REALTIME_MAX_PACKETS; i++)
+    {
+        if (e131Pending == 0)
+        {
+            e131Pending = e131Udp.parsePacket();
+        }
+        if (e131Pending == 0)
+        {
+            break;
+        }
+        frame |= handleE131(e131Pending);
+        e131Pending = 0;
+    }
+
+    if (frame)
+    {
+        lastPacket = millis();
+        if (!active)
+        {
+            Serial.printf("Realtime input started\n");
+            active = true;
+            onActiveChanged(true);
+        }
+    }
+    else if (active && millis() - lastPacket > REALTIME_TIMEOUT)
+    {
+        Serial.printf("Realtime input timed out\n");
+        active = false;
+        onActiveChanged(false);
+    }
+
+    return frame;
+}
+
+bool RealtimeClient::handleDdp(int size)
+{
+    uint8_t header[DDP_HEADER_SIZE + DDP_TIMECODE_SIZE];
+    if (size < DDP_HEADER_SIZE || ddpUdp.read(header, DDP_HEADER_SIZE) != DDP_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    uint8_t flags = header[0];
+    if ((flags & DDP_FLAG_VERSION_MASK) != DDP_FLAG_VERSION_1 || header[3] != DDP_ID_DISPLAY)
+    {
+        return false;
+    }
+
+    int headerSize = DDP_HEADER_SIZE;
+    if (flags & DDP_FLAG_TIMECODE)
+    {
+        ddpUdp.read(header + DDP_HEADER_SIZE, DDP_TIMECODE_SIZE);
+        headerSize += DDP_TIMECODE_SIZE;
+    }
+
+    uint32_t offset = ((uint32_t)header[4] << 24) | ((uint32_t)header[5] << 16) | ((uint32_t)header[6] << 8) | header[7];
+    size_t length = ((size_t)header[8] << 8) | header[9];
+    if (length > (size_t)(size - headerSize))
+    {
+        length = size - headerSize;
+    }
+
+    // Copy straight into the led buffer, clipped to its size
+    if (offset < bufferSize)
+    {
+        if (length > bufferSize - offset)
+        {
+            length = bufferSize - offset;
+        }
+        ddpUdp.read(buffer + offset, length);
+    }
+
+    return flags & DDP_FLAG_PUSH;
+}
+
+bool RealtimeClient::handleE131(int size)
+{
+    uint8_t header[E131_HEADER_SIZE];
+    if (size < E131_HEADER_SIZE || e131Udp.read(header, E131_HEADER_SIZE) != E131_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    // ACN packet identifier, data packet vectors and DMX null start code
+    if (memcmp(header + 4, e131AcnId, sizeof(e131AcnId)) != 0 ||
+        header[21] != 0x04 ||
+        header[43] != 0x02 ||
+        header[117] != 0x02 ||
+        header[125] != 0x00)
+    {
+        return false;
+    }
+
+    uint16_t universe = (header[113] << 8) | header[114];
+    if (universe < E131_START_UNIVERSE)
+    {
+        return false;
+    }
+
+    // Property value count includes the start code. Slots 511 and 512 of a
+    // full universe would overlap the next one and are dropped
+    size_t length = ((header[123] << 8) | header[124]) - 1;
+    if (length > (size_t)(size - E131_HEADER_SIZE))
+    {
+        length = size - E131_HEADER_SIZE;
+    }
+    length = min(length, (size_t)E131_UNIVERSE_CHANNELS);
+
+    // 170 RGB pixels per universe
+    size_t offset = (size_t)(universe - E131_START_UNIVERSE) * E131_UNIVERSE_CHANNELS;
+    if (offset < bufferSize)
+    {
+        if (length > bufferSize - offset)
+        {
+            length = bufferSize - offset;
+        }
+        e131Udp.read(buffer + offset, length);
+    }
+
+    // Frame is complete once the universe holding the last pixel arrived
+    return offset < bufferSize && offset + E131_UNIVERSE_CHANNELS >= bufferSize;
+}
+
+bool RealtimeClient::isActive()
+{
+    return active;
+}
+
+bool RealtimeClient::hasPendingData()
+{
+    if (ddpPending == 0)
+    {
+        ddpPending = ddpUdp.parsePacket();
+    }
+    if (e131Pending == 0)
+    {
+        e131Pending = e131Udp.parsePacket();
+    }
+    return ddpPending > 0 || e131Pending > 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "segment.hpp"
+
+void Segment::setState(bool _on)
+{
+    on = _on;
+    dirty = true;
+}
+
+void Segment::setBrightness(uint8_t _brightness)
+{
+    brightness = _brightness;
+    dirty = true;
+}
+
+void Segment::setColor(uint8_t r, uint8_t g, uint8_t b)
+{
+    color.setRGB(r, g, b);
+    dirty = true;
+}
+
+void Segment::setEffect(const char *_effect, EffectProgram *_program)
+{
+    effect = _effect;
+    program = _program;
+    programPixel = 0;
+    dirty = true;
+    if (program != nullptr)
+    {
+        Serial.printf("Starting effect program %s on segment '%s'\n", effect.c_str(), id.c_str());
+    }
+    else if (effect == "rainbow")
+    {
+        Serial.printf("Starting effect %s on segment '%s'\n", effect.c_str(), id.c_str());
+        effectColorR = color.r;
+        effectColorG = color.g;
+        effectColorB = color.b;
+    }
+    else if (effect == "pulse")
+    {
+        Serial.printf("Starting effect %s on segment '%s'\n", effect.c_str(), id.c_str());
+        effectBrightness = brightness;
+        effectBrightnessIncrease = false;
+    }
+}
+
+bool Segment::usesProgram(EffectProgram *_program)
+{
+    return program == _program;
+}
+
+bool Segment::isAnimating()
+{
+    // Effects only need to be rendered while the light is on
+    return on && effect != "none";
+}
+
+void Segment::step(uint32_t &budget)
+{
+    if (program != nullptr)
+    {
+        // Pixels left over by an exhausted budget are rendered next frame
+        program->run(leds, count, programPixel, millis(), budget);
+        dirty = true;
+    }
+    else if (effect == "rainbow")
+    {
+        // There is probably a better way to rotate through all rgb colors like using hsv
+        if (effectColorR == 255 && effectColorG < 255 && effectColorB == 0)
+        {
+            effectColorG++;
+        }
+        else if (effectColorR > 0 && effectColorG == 255 && effectColorB == 0)
+        {
+            effectColorR--;
+        }
+        else if (effectColorR == 0 && effectColorG == 255 && effectColorB < 255)
+        {
+            effectColorB++;
+        }
+        else if (effectColorR == 0 && effectColorG > 0 && effectColorB == 255)
+        {
+            effectColorG--;
+        }
+        else if (effectColorR < 255 && effectColorG == 0 && effectColorB == 255)
+        {
+            effectColorR++;
+        }
+        else if (effectColorR == 255 && effectColorG == 0 && effectColorB > 0)
+        {
+            effectColorB--;
+        }
+        dirty = true;
+    }
+    else if (effect == "pulse")
+    {
+        if (effectBrightness <= 0)
+        {
+            effectBrightnessIncrease = true;
+        }
+        else if (effectBrightness >= 255)
+        {
+            effectBrightnessIncrease = false;
+        }
+        effectBrightness = constrain(effectBrightness + (effectBrightnessIncrease ? 3 : -3), 0, 255);
+        dirty = true;
+    }
+}
+
+void Segment::render()
+{
+    // Effect programs write their pixels while stepping
+    if (on && program != nullptr)
+    {
+        return;
+    }
+
+    CRGB target = CRGB::Black;
+    if (on)
+    {
+        target = color;
+        if (program == nullptr && effect == "rainbow")
+        {
+            target.setRGB(effectColorR, effectColorG, effectColorB);
+        }
+    }
+    fill_solid(leds, count, target);
+}
+
+uint8_t Segment::outputBrightness()
+{
+    if (program == nullptr && effect == "pulse")
+    {
+        return 255;
+    }
+    return brightness;
+}
+
+uint8_t Segment::outputScale()
+{
+    if (program == nullptr && effect == "pulse")
+    {
+        return effectBrightness;
+    }
+    return 255;
+}
@@ -0,0 +1,418 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Simulated time, advanced by delay
+inline unsigned long stubMillis = 0;
+
+inline unsigned long millis()
+{
+    return stubMillis;
+}
+
+inline unsigned long micros()
+{
+    return stubMillis * 1000;
+}
+
+inline void delay(unsigned long ms)
+{
+    stubMillis += ms;
+}
+
+inline void yield()
+{
+}
+
+inline void randomSeed(unsigned long)
+{
+}
+
+inline void configTime(int, int, const char *)
+{
+}
+
+/**
+ * @brief Heap backed string like the ESP8266 core String
+ *
+ * Short strings are stored inline like the core's small string
+ * optimization on 32 bit, longer ones in 16 byte steps on the heap.
+ */
+class String
+{
+private:
+    static const unsigned int SSO_CAPACITY = 10;
+
+    char sso[SSO_CAPACITY + 1] = "";
+    char *heap = nullptr;
+    unsigned int capacity = SSO_CAPACITY;
+    unsigned int len = 0;
+
+    char *buffer()
+    {
+        return heap != nullptr ? heap : sso;
+    }
+
+    void copy(const char *cstr, unsigned int length)
+    {
+        if (cstr == nullptr)
+        {
+            invalidate();
+            return;
+        }
+        if (!reserve(length))
+        {
+            return;
+        }
+        memmove(buffer(), cstr, length);
+        len = length;
+        buffer()[len] = '\0';
+    }
+
+    void invalidate()
+    {
+        free(heap);
+        heap = nullptr;
+        capacity = SSO_CAPACITY;
+        len = 0;
+        sso[0] = '\0';
+    }
+
+public:
+    String(const char *cstr = "")
+    {
+        copy(cstr, cstr != nullptr ? strlen(cstr) : 0);
+    }
+
+    String(const char *cstr, unsigned int length)
+    {
+        copy(cstr, length);
+    }
+
+    String(const String &other)
+    {
+        copy(other.c_str(), other.len);
+    }
+
+    String(String &&other)
+    {
+        *this = static_cast<String &&>(other);
+    }
+
+    explicit String(char c)
+    {
+        char cstr[2] = {c, '\0'};
+        copy(cstr, 1);
+    }
+
+    explicit String(int value)
+    {
+        char cstr[12];
+        copy(cstr, snprintf(cstr, sizeof(cstr), "%d", value));
+    }
+
+    explicit String(unsigned int value)
+    {
+        char cstr[12];
+        copy(cstr, snprintf(cstr, sizeof(cstr), "%u", value));
+    }
+
+    ~String()
+    {
+        free(heap);
+    }
+
+    String &operator=(const String &other)
+    {
+        if (this != &other)
+        {
+            copy(other.c_str(), other.len);
+        }
+        return *this;
+    }
+
+    String &operator=(String &&other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+        free(heap);
+        heap = other.heap;
+        capacity = other.capacity;
+        len = other.len;
+        memcpy(sso, other.sso, sizeof(sso));
+        other.heap = nullptr;
+        other.capacity = SSO_CAPACITY;
+        other.len = 0;
+        other.sso[0] = '\0';
+        return *this;
+    }
+
+    String &operator=(const char *cstr)
+    {
+        copy(cstr, cstr != nullptr ? strlen(cstr) : 0);
+        return *this;
+    }
+
+    bool reserve(unsigned int size)
+    {
+        if (size <= capacity)
+        {
+            return true;
+        }
+        unsigned int newCapacity = ((size + 16) & ~0xf) - 1;
+        char *newBuffer = (char *)realloc(heap, newCapacity + 1);
+        if (newBuffer == nullptr)
+        {
+            return false;
+        }
+        if (heap == nullptr)
+        {
+            memcpy(newBuffer, sso, len + 1);
+        }
+        heap = newBuffer;
+        capacity = newCapacity;
+        return true;
+    }
+
+    bool concat(const char *cstr, unsigned int length)
+    {
+        if (cstr == nullptr || !reserve(len + length))
+        {
+            return false;
+        }
+        memmove(buffer() + len, cstr, length);
+        len += length;
+        buffer()[len] = '\0';
+        return true;
+    }
+
+    bool concat(const char *cstr)
+    {
+        return cstr != nullptr && concat(cstr, strlen(cstr));
+    }
+
+    bool concat(const String &other)
+    {
+        return concat(other.c_str(), other.len);
+    }
+
+    bool concat(char c)
+    {
+        return concat(&c, 1);
+    }
+
+    String &operator+=(const String &other)
+    {
+        concat(other);
+        return *this;
+    }
+
+    String &operator+=(const char *cstr)
+    {
+        concat(cstr);
+        return *this;
+    }
+
+    String &operator+=(char c)
+    {
+        concat(c);
+        return *this;
+    }
+
+    const char *c_str() const
+    {
+        return heap != nullptr ? heap : sso;
+    }
+
+    unsigned int length() const
+    {
+        return len;
+    }
+
+    const char *begin() const
+    {
+        return c_str();
+    }
+
+    const char *end() const
+    {
+        return c_str() + len;
+    }
+
+    char operator[](unsigned int index) const
+    {
+        return index < len ? c_str()[index] : '\0';
+    }
+
+    bool equals(const char *cstr) const
+    {
+        return strcmp(c_str(), cstr != nullptr ? cstr : "") == 0;
+    }
+
+    bool operator==(const String &other) const
+    {
+        return len == other.len && equals(other.c_str());
+    }
+
+    bool operator==(const char *cstr) const
+    {
+        return equals(cstr);
+    }
+
+    bool operator!=(const String &other) const
+    {
+        return !(*this == other);
+    }
+
+    bool operator!=(const char *cstr) const
+    {
+        return !equals(cstr);
+    }
+
+    bool operator<(const String &other) const
+    {
+        return strcmp(c_str(), other.c_str()) < 0;
+    }
+};
+
+// Kept for libraries that still refer to the old concatenation helper
+class StringSumHelper : public String
+{
+public:
+    using String::String;
+};
+
+inline String operator+(const String &lhs, const String &rhs)
+{
+    String result;
+    result.reserve(lhs.length() + rhs.length());
+    result += lhs;
+    result += rhs;
+    return result;
+}
+
+inline String operator+(const String &lhs, const char *rhs)
+{
+    String result;
+    result.reserve(lhs.length() + strlen(rhs));
+    result += lhs;
+    result += rhs;
+    return result;
+}
+
+inline String operator+(const char *lhs, const String &rhs)
+{
+    String result;
+    result.reserve(strlen(lhs) + rhs.length());
+    result += lhs;
+    result += rhs;
+    return result;
+}
+
+inline String operator+(String &&lhs, const String &rhs)
+{
+    lhs += rhs;
+    return static_cast<String &&>(lhs);
+}
+
+inline String operator+(String &&lhs, const char *rhs)
+{
+    lhs += rhs;
+    return static_cast<String &&>(lhs);
+}
+
+inline bool operator==(const char *lhs, const String &rhs)
+{
+    return rhs == lhs;
+}
+
+/**
+ * @brief Serial console, output is dropped unless echo or capture is set
+ */
+class SerialStub
+{
+public:
+    bool echo = false;
+
+    // Keep the last printed message in output
+    bool capture = false;
+    char output[256] = "";
+
+    void begin(unsigned long)
+    {
+    }
+
+    int printf(const char *format, ...)
+    {
+        if (!echo && !capture)
+        {
+            return 0;
+        }
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(output, sizeof(output), format, args);
+        va_end(args);
+        if (echo)
+        {
+            fputs(output, stdout);
+        }
+        return length;
+    }
+
+    void print(const char *text)
+    {
+        printf("%s", text);
+    }
+
+    void println(const char *text)
+    {
+        printf("%s\n", text);
+    }
+};
+
+inline SerialStub Serial;
+
+#endif
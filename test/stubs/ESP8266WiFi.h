@@ -0,0 +1,123 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ESP8266_WIFI_STUB_H
+#define ESP8266_WIFI_STUB_H
+
+#include "Arduino.h"
+#include "heap_model.h"
+
+#define WIFI_STA 1
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+enum WiFiSleepType
+{
+    WIFI_NONE_SLEEP = 0,
+    WIFI_LIGHT_SLEEP = 1,
+    WIFI_MODEM_SLEEP = 2
+};
+
+/**
+ * @brief Station that is always associated
+ */
+class WiFiStub
+{
+public:
+    // Station default of the ESP8266
+    WiFiSleepType sleepMode = WIFI_MODEM_SLEEP;
+
+    void mode(int)
+    {
+    }
+
+    bool setSleepMode(WiFiSleepType type, uint8_t = 0)
+    {
+        sleepMode = type;
+        return true;
+    }
+
+    void begin(const String &, const String &)
+    {
+    }
+
+    uint8_t status()
+    {
+        return WL_CONNECTED;
+    }
+};
+
+inline WiFiStub WiFi;
+
+/**
+ * @brief TCP client, the MQTT stand-in does not use a socket
+ */
+class WiFiClient
+{
+public:
+    virtual ~WiFiClient()
+    {
+    }
+
+    virtual int connect(const char *, uint16_t)
+    {
+        return 1;
+    }
+
+    virtual void stop()
+    {
+    }
+
+    virtual int available()
+    {
+        return 0;
+    }
+};
+
+/**
+ * @brief Heap statistics of the heap model
+ */
+class EspStub
+{
+public:
+    uint32_t getFreeHeap()
+    {
+        return heapModelFree();
+    }
+
+    uint32_t getMaxFreeBlockSize()
+    {
+        return heapModelLargestBlock();
+    }
+
+    uint8_t getHeapFragmentation()
+    {
+        uint32_t free = heapModelFree();
+        return free > 0 ? 100 - (uint64_t)heapModelLargestBlock() * 100 / free : 0;
+    }
+};
+
+inline EspStub ESP;
+
+#endif
@@ -0,0 +1,244 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FASTLED_STUB_H
+#define FASTLED_STUB_H
+
+#include "Arduino.h"
+
+typedef uint8_t fract8;
+
+inline uint8_t scale8(uint8_t i, fract8 scale)
+{
+    return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+inline uint8_t scale8_video(uint8_t i, fract8 scale)
+{
+    return (((uint16_t)i * scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+inline uint16_t scale16by8(uint16_t i, fract8 scale)
+{
+    return ((uint32_t)i * (1 + (uint32_t)scale)) >> 8;
+}
+
+/**
+ * @brief Sine over a full turn of 0..65535, same table as FastLED's sin16_C
+ */
+inline int16_t sin16(uint16_t theta)
+{
+    static const uint16_t base[] = {0, 6393, 12539, 18204, 23170, 27245, 30273, 32137};
+    static const uint8_t slope[] = {49, 48, 44, 38, 31, 23, 14, 4};
+
+    uint16_t offset = (theta & 0x3FFF) >> 3;
+    if (theta & 0x4000)
+    {
+        offset = 2047 - offset;
+    }
+    uint8_t section = offset / 256;
+    uint8_t secoffset8 = (uint8_t)offset / 2;
+    int16_t y = slope[section] * secoffset8 + base[section];
+    return (theta & 0x8000) ? -y : y;
+}
+
+struct CHSV
+{
+    uint8_t hue;
+    uint8_t sat;
+    uint8_t val;
+
+    CHSV(uint8_t h, uint8_t s, uint8_t v) : hue(h), sat(s), val(v)
+    {
+    }
+};
+
+struct CRGB
+{
+    union
+    {
+        struct
+        {
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+        };
+        uint8_t raw[3];
+    };
+
+    enum HTMLColorCode
+    {
+        Black = 0x000000,
+        White = 0xFFFFFF
+    };
+
+    CRGB() : r(0), g(0), b(0)
+    {
+    }
+
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib)
+    {
+    }
+
+    CRGB(HTMLColorCode code) : r((code >> 16) & 0xFF), g((code >> 8) & 0xFF), b(code & 0xFF)
+    {
+    }
+
+    CRGB &setRGB(uint8_t nr, uint8_t ng, uint8_t nb)
+    {
+        r = nr;
+        g = ng;
+        b = nb;
+        return *this;
+    }
+
+    bool operator==(const CRGB &other) const
+    {
+        return r == other.r && g == other.g && b == other.b;
+    }
+};
+
+/**
+ * @brief Rainbow hue conversion with the same sections as FastLED
+ */
+inline void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb)
+{
+    uint8_t hue = hsv.hue;
+    uint8_t sat = hsv.sat;
+    uint8_t val = hsv.val;
+
+    uint8_t offset8 = (hue & 0x1F) << 3;
+    uint8_t third = scale8(offset8, 85);
+    uint8_t twothirds = scale8(offset8, 170);
+    uint8_t r, g, b;
+    switch (hue >> 5)
+    {
+    case 0:
+        r = 255 - third, g = third, b = 0;
+        break;
+    case 1:
+        r = 171, g = 85 + third, b = 0;
+        break;
+    case 2:
+        r = 171 - twothirds, g = 170 + third, b = 0;
+        break;
+    case 3:
+        r = 0, g = 255 - third, b = third;
+        break;
+    case 4:
+        r = 0, g = 171 - twothirds, b = 85 + twothirds;
+        break;
+    case 5:
+        r = third, g = 0, b = 255 - third;
+        break;
+    case 6:
+        r = 85 + third, g = 0, b = 171 - third;
+        break;
+    default:
+        r = 170 + third, g = 0, b = 85 - third;
+        break;
+    }
+
+    if (sat != 255)
+    {
+        uint8_t desat = 255 - sat;
+        desat = scale8_video(desat, desat);
+        uint8_t satscale = 255 - desat;
+        r = scale8(r, satscale) + desat;
+        g = scale8(g, satscale) + desat;
+        b = scale8(b, satscale) + desat;
+    }
+
+    if (val != 255)
+    {
+        val = scale8_video(val, val);
+        r = scale8(r, val);
+        g = scale8(g, val);
+        b = scale8(b, val);
+    }
+
+    rgb.setRGB(r, g, b);
+}
+
+inline void fill_solid(CRGB *leds, int count, const CRGB &color)
+{
+    for (int i = 0; i < count; i++)
+    {
+        leds[i] = color;
+    }
+}
+
+enum EOrder
+{
+    RGB = 0012,
+    GRB = 0102
+};
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER>
+class WS2812B
+{
+};
+
+class CLEDController
+{
+public:
+    void showLeds(uint8_t)
+    {
+    }
+};
+
+/**
+ * @brief Controller registry, nothing is sent
+ */
+class FastLEDStub
+{
+private:
+    CLEDController controller;
+    uint8_t brightness = 255;
+
+public:
+    template <template <uint8_t, EOrder> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+    CLEDController &addLeds(CRGB *, int)
+    {
+        return controller;
+    }
+
+    void show()
+    {
+    }
+
+    void setBrightness(uint8_t scale)
+    {
+        brightness = scale;
+    }
+
+    uint8_t getBrightness()
+    {
+        return brightness;
+    }
+};
+
+inline FastLEDStub FastLED;
+
+#endif
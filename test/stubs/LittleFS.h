@@ -0,0 +1,117 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LITTLEFS_STUB_H
+#define LITTLEFS_STUB_H
+
+#include "Arduino.h"
+
+/**
+ * @brief File that never exists
+ */
+class File
+{
+public:
+    explicit operator bool() const
+    {
+        return false;
+    }
+
+    size_t size()
+    {
+        return 0;
+    }
+
+    size_t read(uint8_t *, size_t)
+    {
+        return 0;
+    }
+
+    size_t write(const uint8_t *, size_t)
+    {
+        return 0;
+    }
+
+    String readString()
+    {
+        return String();
+    }
+
+    void close()
+    {
+    }
+};
+
+/**
+ * @brief Directory without entries
+ */
+class Dir
+{
+public:
+    bool next()
+    {
+        return false;
+    }
+
+    File openFile(const char *)
+    {
+        return File();
+    }
+
+    String fileName()
+    {
+        return String();
+    }
+};
+
+/**
+ * @brief Empty file system
+ */
+class FileSystemStub
+{
+public:
+    bool begin()
+    {
+        return true;
+    }
+
+    File open(const String &, const char *)
+    {
+        return File();
+    }
+
+    Dir openDir(const char *)
+    {
+        return Dir();
+    }
+
+    bool remove(const String &)
+    {
+        return false;
+    }
+};
+
+inline FileSystemStub LittleFS;
+
+#endif
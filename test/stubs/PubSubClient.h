@@ -0,0 +1,273 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PUB_SUB_CLIENT_STUB_H
+#define PUB_SUB_CLIENT_STUB_H
+
+#include "ESP8266WiFi.h"
+
+#define MQTT_CONNECTED 0
+#define MQTT_DISCONNECTED -1
+
+// Broker limits, kept out of the heap so that only the client is measured
+#define MQTT_BROKER_MAX_SUBSCRIPTIONS 8
+#define MQTT_BROKER_MAX_TOPIC 128
+#define MQTT_BROKER_MAX_PAYLOAD 256
+
+/**
+ * @brief Local MQTT broker with a single client
+ *
+ * Keeps subscriptions of the current session and holds one inbound
+ * message until the client loop picks it up.
+ */
+class MqttBroker
+{
+private:
+    char subscriptions[MQTT_BROKER_MAX_SUBSCRIPTIONS][MQTT_BROKER_MAX_TOPIC];
+    int subscriptionCount = 0;
+
+    // Match a topic against a filter with + and # wildcards
+    static bool matches(const char *filter, const char *topic)
+    {
+        while (*filter != '\0')
+        {
+            if (*filter == '#')
+            {
+                return true;
+            }
+            if (*filter == '+')
+            {
+                while (*topic != '\0' && *topic != '/')
+                {
+                    topic++;
+                }
+                filter++;
+                continue;
+            }
+            if (*filter != *topic)
+            {
+                return false;
+            }
+            filter++;
+            topic++;
+        }
+        return *topic == '\0';
+    }
+
+public:
+    bool connected = false;
+
+    // Inbound message waiting for the client loop
+    bool pending = false;
+    char pendingTopic[MQTT_BROKER_MAX_TOPIC];
+    char pendingPayload[MQTT_BROKER_MAX_PAYLOAD];
+    unsigned int pendingLength = 0;
+
+    // Messages received from the client
+    unsigned long connects = 0;
+    unsigned long publishes = 0;
+    char lastTopic[MQTT_BROKER_MAX_TOPIC] = "";
+    char lastPayload[MQTT_BROKER_MAX_PAYLOAD] = "";
+
+    /**
+     * @brief Accept a client session, subscriptions start empty
+     */
+    void connect()
+    {
+        connected = true;
+        subscriptionCount = 0;
+        pending = false;
+        connects++;
+    }
+
+    /**
+     * @brief Drop the client session
+     */
+    void disconnect()
+    {
+        connected = false;
+        subscriptionCount = 0;
+        pending = false;
+    }
+
+    bool subscribe(const char *filter)
+    {
+        if (!connected || subscriptionCount == MQTT_BROKER_MAX_SUBSCRIPTIONS || strlen(filter) >= MQTT_BROKER_MAX_TOPIC)
+        {
+            return false;
+        }
+        strcpy(subscriptions[subscriptionCount++], filter);
+        return true;
+    }
+
+    bool receive(const char *topic, const uint8_t *payload, unsigned int length)
+    {
+        if (!connected)
+        {
+            return false;
+        }
+        publishes++;
+        snprintf(lastTopic, sizeof(lastTopic), "%s", topic);
+        snprintf(lastPayload, sizeof(lastPayload), "%.*s", (int)length, (const char *)payload);
+        return true;
+    }
+
+    /**
+     * @brief Queue a message for the client if it is subscribed
+     *
+     * @param topic Topic
+     * @param payload Payload
+     * @return true if a subscription matched
+     */
+    bool send(const char *topic, const char *payload)
+    {
+        for (int i = 0; i < subscriptionCount; i++)
+        {
+            if (matches(subscriptions[i], topic))
+            {
+                snprintf(pendingTopic, sizeof(pendingTopic), "%s", topic);
+                pendingLength = snprintf(pendingPayload, sizeof(pendingPayload), "%s", payload);
+                pending = true;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+inline MqttBroker mqttBroker;
+
+/**
+ * @brief PubSubClient connected to the local broker
+ *
+ * Allocates its packet buffer like the library and delivers messages
+ * from that buffer.
+ */
+class PubSubClient
+{
+private:
+    uint8_t *buffer = nullptr;
+    uint16_t bufferSize = 0;
+    std::function<void(char *, uint8_t *, unsigned int)> callback;
+
+public:
+    PubSubClient(WiFiClient &)
+    {
+        setBufferSize(256);
+    }
+
+    ~PubSubClient()
+    {
+        free(buffer);
+    }
+
+    bool setBufferSize(uint16_t size)
+    {
+        uint8_t *resized = (uint8_t *)realloc(buffer, size);
+        if (resized == nullptr)
+        {
+            return false;
+        }
+        buffer = resized;
+        bufferSize = size;
+        return true;
+    }
+
+    PubSubClient &setServer(const char *, uint16_t)
+    {
+        return *this;
+    }
+
+    PubSubClient &setCallback(std::function<void(char *, uint8_t *, unsigned int)> _callback)
+    {
+        callback = _callback;
+        return *this;
+    }
+
+    bool connect(const char *, const char *, const char *, const char *, uint8_t, bool, const char *)
+    {
+        mqttBroker.connect();
+        return true;
+    }
+
+    bool connected()
+    {
+        return mqttBroker.connected;
+    }
+
+    int state()
+    {
+        return mqttBroker.connected ? MQTT_CONNECTED : MQTT_DISCONNECTED;
+    }
+
+    bool loop()
+    {
+        if (!mqttBroker.connected)
+        {
+            return false;
+        }
+        if (!mqttBroker.pending)
+        {
+            return true;
+        }
+        mqttBroker.pending = false;
+
+        // Topic and payload share the packet buffer
+        size_t topicLength = strlen(mqttBroker.pendingTopic);
+        if (topicLength + 1 + mqttBroker.pendingLength > bufferSize)
+        {
+            return true;
+        }
+        char *topic = (char *)buffer;
+        uint8_t *payload = buffer + topicLength + 1;
+        memcpy(topic, mqttBroker.pendingTopic, topicLength + 1);
+        memcpy(payload, mqttBroker.pendingPayload, mqttBroker.pendingLength);
+        if (callback)
+        {
+            callback(topic, payload, mqttBroker.pendingLength);
+        }
+        return true;
+    }
+
+    bool subscribe(const char *topic)
+    {
+        return mqttBroker.subscribe(topic);
+    }
+
+    bool publish(const char *topic, const char *payload)
+    {
+        return publish(topic, (const uint8_t *)payload, strlen(payload));
+    }
+
+    bool publish(const char *topic, const uint8_t *payload, unsigned int length)
+    {
+        if (strlen(topic) + length + 7 > bufferSize)
+        {
+            return false;
+        }
+        return mqttBroker.receive(topic, payload, length);
+    }
+};
+
+#endif
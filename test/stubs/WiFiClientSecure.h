@@ -0,0 +1,88 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WIFI_CLIENT_SECURE_STUB_H
+#define WIFI_CLIENT_SECURE_STUB_H
+
+#include "ESP8266WiFi.h"
+
+namespace BearSSL
+{
+    class Session
+    {
+    };
+
+    class X509List
+    {
+    public:
+        X509List(const char *)
+        {
+        }
+
+        unsigned getCount()
+        {
+            return 0;
+        }
+    };
+
+    /**
+     * @brief TLS client, only declared so that NetworkClient builds
+     */
+    class WiFiClientSecure : public WiFiClient
+    {
+    public:
+        void setSession(Session *)
+        {
+        }
+
+        bool setFingerprint(const char *)
+        {
+            return true;
+        }
+
+        void setTrustAnchors(const X509List *)
+        {
+        }
+
+        void setBufferSizes(int, int)
+        {
+        }
+
+        int getLastSSLError(char *dest, size_t length)
+        {
+            if (dest != nullptr && length > 0)
+            {
+                dest[0] = '\0';
+            }
+            return 0;
+        }
+
+        static bool probeMaxFragmentLength(const String &, uint16_t, uint16_t)
+        {
+            return false;
+        }
+    };
+}
+
+#endif
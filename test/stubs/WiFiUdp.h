@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WIFI_UDP_STUB_H
+#define WIFI_UDP_STUB_H
+
+#include "Arduino.h"
+
+// Datagrams queued for all ports, kept out of the heap
+#define UDP_NETWORK_MAX_PACKETS 16
+#define UDP_NETWORK_MAX_PACKET_SIZE 1500
+
+/**
+ * @brief Local network carrying datagrams from a test sender to WiFiUDP
+ */
+class UdpNetwork
+{
+private:
+    struct Packet
+    {
+        uint16_t port;
+        uint16_t size;
+        uint8_t data[UDP_NETWORK_MAX_PACKET_SIZE];
+    };
+
+    Packet packets[UDP_NETWORK_MAX_PACKETS];
+    int count = 0;
+
+public:
+    /**
+     * @brief Queue a datagram
+     *
+     * @param port Destination port
+     * @param data Payload
+     * @param size Payload byte count
+     * @return true if queued
+     */
+    bool send(uint16_t port, const uint8_t *data, size_t size)
+    {
+        if (count == UDP_NETWORK_MAX_PACKETS || size > UDP_NETWORK_MAX_PACKET_SIZE)
+        {
+            return false;
+        }
+        packets[count].port = port;
+        packets[count].size = size;
+        memcpy(packets[count].data, data, size);
+        count++;
+        return true;
+    }
+
+    /**
+     * @brief Take the oldest datagram for a port
+     *
+     * @param port Port
+     * @param data Target of at least UDP_NETWORK_MAX_PACKET_SIZE bytes
+     * @return int Datagram size, 0 if none is queued
+     */
+    int receive(uint16_t port, uint8_t *data)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (packets[i].port != port)
+            {
+                continue;
+            }
+            int size = packets[i].size;
+            memcpy(data, packets[i].data, size);
+            for (int j = i + 1; j < count; j++)
+            {
+                packets[j - 1] = packets[j];
+            }
+            count--;
+            return size;
+        }
+        return 0;
+    }
+
+    int pending()
+    {
+        return count;
+    }
+};
+
+inline UdpNetwork udpNetwork;
+
+/**
+ * @brief UDP socket on the local network
+ */
+class WiFiUDP
+{
+private:
+    uint16_t port = 0;
+    uint8_t packet[UDP_NETWORK_MAX_PACKET_SIZE];
+    int size = 0;
+    int position = 0;
+
+public:
+    uint8_t begin(uint16_t _port)
+    {
+        port = _port;
+        return 1;
+    }
+
+    int parsePacket()
+    {
+        size = port != 0 ? udpNetwork.receive(port, packet) : 0;
+        position = 0;
+        return size;
+    }
+
+    int available()
+    {
+        return size - position;
+    }
+
+    int read(uint8_t *data, size_t length)
+    {
+        int count = min((int)length, available());
+        memcpy(data, packet + position, count);
+        position += count;
+        return count;
+    }
+};
+
+#endif
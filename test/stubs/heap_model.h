@@ -0,0 +1,327 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HEAP_MODEL_H
+#define HEAP_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Heap available to the sketch on an ESP8266 with WiFi connected
+#define HEAP_MODEL_SIZE (40 * 1024)
+
+// Block header size and alignment of all blocks
+#define HEAP_MODEL_ALIGN 16
+
+/**
+ * @brief First fit heap with coalescing, sized like the ESP8266 heap
+ *
+ * malloc, calloc, realloc and free are redirected with the linker flag
+ * --wrap, operator new and delete use them as well. Memory allocated
+ * before or outside the model is passed on to the C library.
+ *
+ * Define HEAP_MODEL_IMPLEMENTATION in exactly one translation unit
+ * before including this header.
+ */
+uint32_t heapModelFree();
+uint32_t heapModelLargestBlock();
+uint32_t heapModelLowWater();
+void heapModelResetLowWater();
+uint32_t heapModelLiveBlocks();
+uint32_t heapModelAllocations();
+uint32_t heapModelFailures();
+
+#ifdef HEAP_MODEL_IMPLEMENTATION
+
+#include <cstring>
+#include <new>
+
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t count, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+    void __real_free(void *ptr);
+}
+
+struct HeapModelBlock
+{
+    // Block size including header, 0 marks the end of the heap
+    uint32_t size;
+    uint32_t previousSize;
+    uint32_t used;
+    uint32_t padding;
+};
+
+alignas(HEAP_MODEL_ALIGN) static uint8_t heapModelArena[HEAP_MODEL_SIZE];
+static uint32_t heapModelFreeBytes = 0;
+static uint32_t heapModelLowWaterBytes = 0;
+static uint32_t heapModelLive = 0;
+static uint32_t heapModelAllocationCount = 0;
+static uint32_t heapModelFailureCount = 0;
+
+static HeapModelBlock *heapModelFirst()
+{
+    HeapModelBlock *first = (HeapModelBlock *)heapModelArena;
+    if (first->size == 0 && heapModelFreeBytes == 0)
+    {
+        first->size = HEAP_MODEL_SIZE;
+        heapModelFreeBytes = HEAP_MODEL_SIZE;
+        heapModelLowWaterBytes = HEAP_MODEL_SIZE;
+    }
+    return first;
+}
+
+static HeapModelBlock *heapModelNext(HeapModelBlock *block)
+{
+    uint8_t *next = (uint8_t *)block + block->size;
+    return next < heapModelArena + HEAP_MODEL_SIZE ? (HeapModelBlock *)next : nullptr;
+}
+
+static HeapModelBlock *heapModelPrevious(HeapModelBlock *block)
+{
+    return block->previousSize > 0 ? (HeapModelBlock *)((uint8_t *)block - block->previousSize) : nullptr;
+}
+
+static bool heapModelOwns(void *ptr)
+{
+    return ptr >= (void *)heapModelArena && ptr < (void *)(heapModelArena + HEAP_MODEL_SIZE);
+}
+
+static HeapModelBlock *heapModelHeader(void *ptr)
+{
+    return (HeapModelBlock *)ptr - 1;
+}
+
+static void *heapModelAllocate(size_t size)
+{
+    size_t needed = (size + 2 * HEAP_MODEL_ALIGN - 1) / HEAP_MODEL_ALIGN * HEAP_MODEL_ALIGN;
+    for (HeapModelBlock *block = heapModelFirst(); block != nullptr; block = heapModelNext(block))
+    {
+        if (block->used || block->size < needed)
+        {
+            continue;
+        }
+
+        // Split off the rest if it can hold another block
+        if (block->size - needed >= 2 * HEAP_MODEL_ALIGN)
+        {
+            HeapModelBlock *rest = (HeapModelBlock *)((uint8_t *)block + needed);
+            rest->size = block->size - needed;
+            rest->previousSize = needed;
+            rest->used = 0;
+            HeapModelBlock *next = heapModelNext(rest);
+            if (next != nullptr)
+            {
+                next->previousSize = rest->size;
+            }
+            block->size = needed;
+        }
+
+        block->used = 1;
+        heapModelFreeBytes -= block->size;
+        if (heapModelFreeBytes < heapModelLowWaterBytes)
+        {
+            heapModelLowWaterBytes = heapModelFreeBytes;
+        }
+        heapModelLive++;
+        heapModelAllocationCount++;
+        return block + 1;
+    }
+
+    heapModelFailureCount++;
+    return nullptr;
+}
+
+static void heapModelRelease(void *ptr)
+{
+    HeapModelBlock *block = heapModelHeader(ptr);
+    block->used = 0;
+    heapModelFreeBytes += block->size;
+    heapModelLive--;
+
+    // Merge with free neighbours
+    HeapModelBlock *next = heapModelNext(block);
+    if (next != nullptr && !next->used)
+    {
+        block->size += next->size;
+    }
+    HeapModelBlock *previous = heapModelPrevious(block);
+    if (previous != nullptr && !previous->used)
+    {
+        previous->size += block->size;
+        block = previous;
+    }
+    next = heapModelNext(block);
+    if (next != nullptr)
+    {
+        next->previousSize = block->size;
+    }
+}
+
+extern "C"
+{
+    void *__wrap_malloc(size_t size)
+    {
+        return heapModelAllocate(size);
+    }
+
+    void *__wrap_calloc(size_t count, size_t size)
+    {
+        void *ptr = heapModelAllocate(count * size);
+        if (ptr != nullptr)
+        {
+            memset(ptr, 0, count * size);
+        }
+        return ptr;
+    }
+
+    void __wrap_free(void *ptr)
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+        if (!heapModelOwns(ptr))
+        {
+            __real_free(ptr);
+            return;
+        }
+        heapModelRelease(ptr);
+    }
+
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        if (ptr == nullptr)
+        {
+            return heapModelAllocate(size);
+        }
+        if (!heapModelOwns(ptr))
+        {
+            return __real_realloc(ptr, size);
+        }
+        if (size == 0)
+        {
+            heapModelRelease(ptr);
+            return nullptr;
+        }
+
+        size_t available = heapModelHeader(ptr)->size - HEAP_MODEL_ALIGN;
+        if (available >= size)
+        {
+            return ptr;
+        }
+        void *moved = heapModelAllocate(size);
+        if (moved != nullptr)
+        {
+            memcpy(moved, ptr, available);
+            heapModelRelease(ptr);
+        }
+        return moved;
+    }
+}
+
+void *operator new(size_t size)
+{
+    void *ptr = __wrap_malloc(size);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    __wrap_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    __wrap_free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    __wrap_free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    __wrap_free(ptr);
+}
+
+uint32_t heapModelFree()
+{
+    heapModelFirst();
+    return heapModelFreeBytes;
+}
+
+uint32_t heapModelLargestBlock()
+{
+    uint32_t largest = 0;
+    for (HeapModelBlock *block = heapModelFirst(); block != nullptr; block = heapModelNext(block))
+    {
+        if (!block->used && block->size - HEAP_MODEL_ALIGN > largest)
+        {
+            largest = block->size - HEAP_MODEL_ALIGN;
+        }
+    }
+    return largest;
+}
+
+uint32_t heapModelLowWater()
+{
+    heapModelFirst();
+    return heapModelLowWaterBytes;
+}
+
+void heapModelResetLowWater()
+{
+    heapModelLowWaterBytes = heapModelFree();
+}
+
+uint32_t heapModelLiveBlocks()
+{
+    return heapModelLive;
+}
+
+uint32_t heapModelAllocations()
+{
+    return heapModelAllocationCount;
+}
+
+uint32_t heapModelFailures()
+{
+    return heapModelFailureCount;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define HEAP_MODEL_IMPLEMENTATION
+#include <heap_model.h>
+
+#include <chrono>
+#include <unity.h>
+
+#include "color_pipeline.hpp"
+#include "effect_vm.hpp"
+#include "segment.hpp"
+
+// Leds rendered per frame
+#define BENCHMARK_LEDS 64
+
+// Frames per measurement
+#define BENCHMARK_FRAMES 20000
+
+// Effect step interval of the main loop in ms
+#define BENCHMARK_STEP_INTERVAL 50
+
+// Moving rainbow from the README, 8 instructions: hue = pos + time / 4
+static const uint8_t movingRainbow[] = {
+    0x05, 0x02, 0x01, 0x00, 0x40, 0x00, 0x00, 0x22, 0x20,
+    0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0x50};
+
+#define MOVING_RAINBOW_INSTRUCTIONS 8
+
+typedef Strip<0, 0, BENCHMARK_LEDS> BenchmarkStrip;
+
+static CRGB leds[BENCHMARK_LEDS];
+static CRGB outputLeds[BENCHMARK_LEDS];
+static const uint8_t calibration[3] = {255, 176, 240};
+
+static unsigned long pixelsPerSecond(std::chrono::steady_clock::duration elapsed)
+{
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    return (uint64_t)BENCHMARK_LEDS * BENCHMARK_FRAMES * 1000000 / (us > 0 ? us : 1);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_effect_program_against_builtin_rainbow()
+{
+    EffectProgram program;
+    TEST_ASSERT_TRUE(program.load("moving_rainbow", movingRainbow, sizeof(movingRainbow)));
+
+    // Built-in rainbow as the main loop runs it: step and render the segment
+    Segment segment = Segment::of<BenchmarkStrip, 0, BENCHMARK_LEDS>("", "Benchmark", leds);
+    segment.setColor(255, 0, 0);
+    segment.setState(true);
+    segment.setEffect("rainbow");
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < BENCHMARK_FRAMES; frame++)
+    {
+        uint32_t budget = VM_FRAME_BUDGET;
+        segment.step(budget);
+        segment.render();
+    }
+    unsigned long rainbow = pixelsPerSecond(std::chrono::steady_clock::now() - start);
+
+    // Same segment running the program
+    segment.setEffect("moving_rainbow", &program);
+    start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < BENCHMARK_FRAMES; frame++)
+    {
+        uint32_t budget = VM_FRAME_BUDGET;
+        stubMillis += BENCHMARK_STEP_INTERVAL;
+        segment.step(budget);
+        segment.render();
+    }
+    unsigned long interpreted = pixelsPerSecond(std::chrono::steady_clock::now() - start);
+
+    char message[128];
+    snprintf(message, sizeof(message), "Effect program %lu pixels/s, built-in rainbow %lu pixels/s",
+             interpreted, rainbow);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(interpreted > 0);
+}
+
+void test_budget_limits_instructions_per_frame()
+{
+    EffectProgram program;
+    TEST_ASSERT_TRUE(program.load("moving_rainbow", movingRainbow, sizeof(movingRainbow)));
+
+    // The budget covers only part of the strip
+    static CRGB large[4000];
+    uint16_t nextPixel = 0;
+    uint32_t budget = VM_FRAME_BUDGET;
+    TEST_ASSERT_FALSE(program.run(large, 4000, nextPixel, 0, budget));
+    TEST_ASSERT_EQUAL_UINT16(VM_FRAME_BUDGET / MOVING_RAINBOW_INSTRUCTIONS, nextPixel);
+    TEST_ASSERT_LESS_THAN_UINT32(MOVING_RAINBOW_INSTRUCTIONS, budget);
+
+    // Remaining pixels are rendered with the next frame
+    budget = VM_FRAME_BUDGET;
+    TEST_ASSERT_TRUE(program.run(large, 4000, nextPixel, 0, budget));
+    TEST_ASSERT_EQUAL_UINT16(0, nextPixel);
+}
+
+// Time of one pipeline pass over all leds in ns
+static unsigned long pipelineFrameTime(ColorPipeline &pipeline, ColorLut &lut, uint8_t brightness, bool pulse)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < BENCHMARK_FRAMES; frame++)
+    {
+        pipeline.apply(0, BENCHMARK_LEDS, lut, brightness, pulse ? (uint8_t)frame : 255);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / BENCHMARK_FRAMES;
+}
+
+void test_color_pipeline_frame_time()
+{
+    for (int i = 0; i < BENCHMARK_LEDS; i++)
+    {
+        leds[i].setRGB(i * 4, 255 - i * 4, i);
+    }
+
+    ColorPipeline pipeline(leds, outputLeds, BENCHMARK_LEDS, 2.2, calibration, false);
+    ColorPipeline dithered(leds, outputLeds, BENCHMARK_LEDS, 2.2, calibration, true);
+    ColorLut lut;
+    ColorLut ditheredLut;
+    unsigned long plain = pipelineFrameTime(pipeline, lut, 128, false);
+    unsigned long dithering = pipelineFrameTime(dithered, ditheredLut, 128, false);
+    unsigned long pulse = pipelineFrameTime(dithered, ditheredLut, 255, true);
+
+    char message[160];
+    snprintf(message, sizeof(message), "Color pipeline for %d leds: %lu ns per frame, %lu ns dithered, %lu ns dithered pulse",
+             BENCHMARK_LEDS, plain, dithering, pulse);
+    TEST_MESSAGE(message);
+
+    // Pulse scales the full brightness tables instead of rebuilding them
+    TEST_ASSERT_EQUAL_INT(255, ditheredLut.brightness);
+}
+
+void test_pulse_scale_matches_rebuilt_tables()
+{
+    for (int i = 0; i < BENCHMARK_LEDS; i++)
+    {
+        leds[i].setRGB(i * 4, 255 - i * 4, i);
+    }
+
+    ColorPipeline pipeline(leds, outputLeds, BENCHMARK_LEDS, 2.2, calibration, false);
+    ColorLut full;
+    ColorLut rebuilt;
+    CRGB scaled[BENCHMARK_LEDS];
+    for (int brightness = 0; brightness < 256; brightness += 15)
+    {
+        pipeline.apply(0, BENCHMARK_LEDS, full, 255, brightness);
+        memcpy(scaled, outputLeds, sizeof(scaled));
+        pipeline.apply(0, BENCHMARK_LEDS, rebuilt, brightness);
+        for (int i = 0; i < BENCHMARK_LEDS; i++)
+        {
+            for (int channel = 0; channel < 3; channel++)
+            {
+                TEST_ASSERT_INT_WITHIN(1, outputLeds[i].raw[channel], scaled[i].raw[channel]);
+            }
+        }
+    }
+}
+
+void test_dithering_skips_exact_tables()
+{
+    const uint8_t neutral[3] = {255, 255, 255};
+    ColorPipeline linear(leds, outputLeds, BENCHMARK_LEDS, 1.0, neutral, true);
+    ColorLut lut;
+    linear.apply(0, BENCHMARK_LEDS, lut, 255);
+    TEST_ASSERT_FALSE(linear.isDithering(lut, 255));
+    TEST_ASSERT_TRUE(linear.isDithering(lut, 128));
+
+    linear.apply(0, BENCHMARK_LEDS, lut, 100);
+    TEST_ASSERT_TRUE(linear.isDithering(lut, 255));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_effect_program_against_builtin_rainbow);
+    RUN_TEST(test_budget_limits_instructions_per_frame);
+    RUN_TEST(test_color_pipeline_frame_time);
+    RUN_TEST(test_pulse_scale_matches_rebuilt_tables);
+    RUN_TEST(test_dithering_skips_exact_tables);
+    return UNITY_END();
+}
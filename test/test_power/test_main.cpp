@@ -0,0 +1,121 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define HEAP_MODEL_IMPLEMENTATION
+#include <heap_model.h>
+
+#include <unity.h>
+
+#include "power.hpp"
+
+// Frames per mode in the duty cycle test
+#define POWER_TEST_FRAMES 100
+
+// Pending work shows up at this time, 0 for never
+static unsigned long workAt = 0;
+
+static PowerManager power([]()
+                          { return workAt != 0 && millis() >= workAt; });
+
+// Simulate a loop iteration taking busy ms before waiting
+static void frame(unsigned long busy, PowerMode mode)
+{
+    stubMillis += busy;
+    power.wait(mode);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_duty_cycle_split()
+{
+    stubMillis = 0;
+    workAt = 0;
+    Serial.capture = true;
+    Serial.output[0] = '\0';
+    power.setup();
+
+    for (int i = 0; i < POWER_TEST_FRAMES; i++)
+    {
+        frame(5, POWER_ACTIVE);
+    }
+    TEST_ASSERT_EQUAL_UINT32(5500, millis());
+    TEST_ASSERT_EQUAL_INT(WIFI_MODEM_SLEEP, WiFi.sleepMode);
+
+    for (int i = 0; i < POWER_TEST_FRAMES; i++)
+    {
+        frame(2, POWER_DITHER);
+    }
+    TEST_ASSERT_EQUAL_UINT32(6700, millis());
+    TEST_ASSERT_EQUAL_INT(WIFI_MODEM_SLEEP, WiFi.sleepMode);
+
+    for (int i = 0; i < POWER_TEST_FRAMES; i++)
+    {
+        frame(1, POWER_REALTIME);
+    }
+    TEST_ASSERT_EQUAL_UINT32(7000, millis());
+    TEST_ASSERT_EQUAL_INT(WIFI_NONE_SLEEP, WiFi.sleepMode);
+
+    // Idle frames sleep IDLE_MAX_SLEEP, the last one until the report is due
+    int idleFrames = 0;
+    while (millis() < POWER_STATS_INTERVAL)
+    {
+        frame(0, POWER_IDLE);
+        idleFrames++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(POWER_STATS_INTERVAL, millis());
+    TEST_ASSERT_EQUAL_INT(11, idleFrames);
+    TEST_ASSERT_EQUAL_INT(WIFI_LIGHT_SLEEP, WiFi.sleepMode);
+
+    TEST_ASSERT_EQUAL_STRING("Power: busy 800ms (1.3%), active sleep 6200ms, idle sleep 53000ms, frames active 300 idle 11\n",
+                             Serial.output);
+    Serial.capture = false;
+}
+
+void test_idle_wait_ends_on_pending_work()
+{
+    // Work arrives between two polls and is picked up with the next one
+    unsigned long start = millis();
+    workAt = start + 350;
+    frame(0, POWER_IDLE);
+    TEST_ASSERT_EQUAL_UINT32(start + 400, millis());
+
+    // Already pending work does not sleep at all
+    start = millis();
+    frame(0, POWER_IDLE);
+    TEST_ASSERT_EQUAL_UINT32(start, millis());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_duty_cycle_split);
+    RUN_TEST(test_idle_wait_ends_on_pending_work);
+    return UNITY_END();
+}
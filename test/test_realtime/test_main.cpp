@@ -0,0 +1,230 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define HEAP_MODEL_IMPLEMENTATION
+#include <heap_model.h>
+
+#include <chrono>
+#include <unity.h>
+
+#include "realtime.hpp"
+
+// Leds fed by the sender, spans two E1.31 universes
+#define REALTIME_LEDS 200
+
+// Frames per throughput measurement
+#define REALTIME_FRAMES 20000
+
+static uint8_t leds[REALTIME_LEDS * 3];
+
+// Active state changes reported by the client
+static int started = 0;
+static int stopped = 0;
+
+static RealtimeClient client(leds, sizeof(leds), [](bool active)
+                             { active ? started++ : stopped++; });
+
+static uint8_t packet[UDP_NETWORK_MAX_PACKET_SIZE];
+
+// Fill a payload with a pattern that differs per frame and byte
+static void pattern(uint8_t *data, size_t length, uint8_t seed)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        data[i] = (uint8_t)(i * 7 + seed);
+    }
+}
+
+// Send a DDP display packet, optionally with timecode
+static void sendDdp(uint32_t offset, const uint8_t *data, uint16_t length, bool push, bool timecode)
+{
+    size_t header = timecode ? 14 : 10;
+    packet[0] = 0x40 | (timecode ? 0x10 : 0) | (push ? 0x01 : 0);
+    packet[1] = 0;
+    packet[2] = 0;
+    packet[3] = 1;
+    packet[4] = offset >> 24;
+    packet[5] = offset >> 16;
+    packet[6] = offset >> 8;
+    packet[7] = offset;
+    packet[8] = length >> 8;
+    packet[9] = length;
+    memset(packet + 10, 0xEE, header - 10);
+    memcpy(packet + header, data, length);
+    TEST_ASSERT_TRUE(udpNetwork.send(DDP_PORT, packet, header + length));
+}
+
+// Send an E1.31 data packet with the DMX slots of one universe
+static void sendE131(uint16_t universe, const uint8_t *data, uint16_t slots)
+{
+    static const uint8_t acnId[] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+    memset(packet, 0, 126);
+    memcpy(packet + 4, acnId, sizeof(acnId));
+    packet[21] = 0x04;
+    packet[43] = 0x02;
+    packet[113] = universe >> 8;
+    packet[114] = universe;
+    packet[117] = 0x02;
+    packet[123] = (slots + 1) >> 8;
+    packet[124] = slots + 1;
+    memcpy(packet + 126, data, slots);
+    TEST_ASSERT_TRUE(udpNetwork.send(E131_PORT, packet, 126 + slots));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_ddp_push_frame()
+{
+    uint8_t data[sizeof(leds)];
+    pattern(data, sizeof(data), 1);
+
+    // Without push the data is written but the frame is not complete
+    sendDdp(0, data, 300, false, false);
+    TEST_ASSERT_FALSE(client.loop());
+    TEST_ASSERT_EQUAL_MEMORY(data, leds, 300);
+    TEST_ASSERT_EQUAL_INT(0, started);
+
+    sendDdp(300, data + 300, sizeof(leds) - 300, true, false);
+    TEST_ASSERT_TRUE(client.loop());
+    TEST_ASSERT_EQUAL_MEMORY(data, leds, sizeof(leds));
+    TEST_ASSERT_TRUE(client.isActive());
+    TEST_ASSERT_EQUAL_INT(1, started);
+}
+
+void test_ddp_timecode_frame()
+{
+    uint8_t data[sizeof(leds)];
+    pattern(data, sizeof(data), 2);
+
+    sendDdp(0, data, sizeof(leds), true, true);
+    TEST_ASSERT_TRUE(client.loop());
+    TEST_ASSERT_EQUAL_MEMORY(data, leds, sizeof(leds));
+
+    // Data past the buffer is clipped
+    sendDdp(sizeof(leds) - 3, data, 30, true, true);
+    TEST_ASSERT_TRUE(client.loop());
+    TEST_ASSERT_EQUAL_MEMORY(data, leds + sizeof(leds) - 3, 3);
+    TEST_ASSERT_EQUAL_INT(1, started);
+}
+
+void test_e131_universes_out_of_order()
+{
+    // Full 512 slot universes, the last two slots do not fit the layout
+    uint8_t first[512];
+    uint8_t second[512];
+    pattern(first, sizeof(first), 3);
+    pattern(second, sizeof(second), 4);
+
+    // Second universe holds the last pixel and completes the frame
+    sendE131(E131_START_UNIVERSE + 1, second, sizeof(second));
+    TEST_ASSERT_TRUE(client.loop());
+    sendE131(E131_START_UNIVERSE, first, sizeof(first));
+    TEST_ASSERT_FALSE(client.loop());
+
+    TEST_ASSERT_EQUAL_MEMORY(first, leds, 510);
+    TEST_ASSERT_EQUAL_MEMORY(second, leds + 510, sizeof(leds) - 510);
+
+    // Universes outside the buffer are ignored
+    sendE131(E131_START_UNIVERSE + 2, first, sizeof(first));
+    TEST_ASSERT_FALSE(client.loop());
+    TEST_ASSERT_EQUAL_MEMORY(second, leds + 510, sizeof(leds) - 510);
+}
+
+void test_timeout_ends_realtime_mode()
+{
+    TEST_ASSERT_TRUE(client.isActive());
+    stubMillis += REALTIME_TIMEOUT;
+    client.loop();
+    TEST_ASSERT_TRUE(client.isActive());
+    TEST_ASSERT_EQUAL_INT(0, stopped);
+
+    stubMillis += 1;
+    client.loop();
+    TEST_ASSERT_FALSE(client.isActive());
+    TEST_ASSERT_EQUAL_INT(1, stopped);
+
+    // Next frame starts it again
+    uint8_t data[sizeof(leds)];
+    pattern(data, sizeof(data), 5);
+    sendDdp(0, data, sizeof(leds), true, false);
+    TEST_ASSERT_TRUE(client.hasPendingData());
+    TEST_ASSERT_TRUE(client.loop());
+    TEST_ASSERT_EQUAL_INT(2, started);
+}
+
+void test_frame_rate_and_latency()
+{
+    uint8_t data[512];
+    pattern(data, sizeof(data), 6);
+
+    // Time from sending the last packet of a frame until loop reports it
+    std::chrono::steady_clock::duration ddp(0);
+    std::chrono::steady_clock::duration e131(0);
+    for (int frame = 0; frame < REALTIME_FRAMES; frame++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        sendDdp(0, data, sizeof(leds), true, false);
+        if (!client.loop())
+        {
+            TEST_FAIL_MESSAGE("DDP frame not complete");
+        }
+        ddp += std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        sendE131(E131_START_UNIVERSE, data, 510);
+        sendE131(E131_START_UNIVERSE + 1, data, sizeof(leds) - 510);
+        if (!client.loop())
+        {
+            TEST_FAIL_MESSAGE("E1.31 frame not complete");
+        }
+        e131 += std::chrono::steady_clock::now() - start;
+    }
+
+    unsigned long ddpNs = std::chrono::duration_cast<std::chrono::nanoseconds>(ddp).count() / REALTIME_FRAMES;
+    unsigned long e131Ns = std::chrono::duration_cast<std::chrono::nanoseconds>(e131).count() / REALTIME_FRAMES;
+    char message[160];
+    snprintf(message, sizeof(message), "Realtime %d leds: DDP %lu ns latency, %lu frames/s, E1.31 %lu ns latency, %lu frames/s",
+             REALTIME_LEDS, ddpNs, 1000000000UL / max(ddpNs, 1UL), e131Ns, 1000000000UL / max(e131Ns, 1UL));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_INT(0, udpNetwork.pending());
+}
+
+int main(int argc, char **argv)
+{
+    client.setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ddp_push_frame);
+    RUN_TEST(test_ddp_timecode_frame);
+    RUN_TEST(test_e131_universes_out_of_order);
+    RUN_TEST(test_timeout_ends_realtime_mode);
+    RUN_TEST(test_frame_rate_and_latency);
+    return UNITY_END();
+}
@@ -0,0 +1,216 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Philipp Kutsch
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define HEAP_MODEL_IMPLEMENTATION
+#include <heap_model.h>
+
+#include <unity.h>
+
+#include "ha_client.hpp"
+
+// Commands replayed with steady traffic
+#define SOAK_COMMANDS 2000000
+
+// Mixed traffic with birth messages and reconnects
+#define SOAK_MIXED_COMMANDS 1000000
+#define SOAK_BIRTH_INTERVAL 10007
+#define SOAK_RECONNECT_INTERVAL 25013
+
+// Free heap the client may use at most while sending discovery
+#define SOAK_MAX_PEAK_USE 8192
+
+// Lamp state behind the entities, handled like the main sketch
+struct Lamp
+{
+    bool on = false;
+    int brightness = 255;
+    int r = 255;
+    int g = 255;
+    int b = 255;
+    String effect = "none";
+};
+
+static Lamp lamps[2];
+
+static const char *commands[][2] = {
+    {"iskaerna/SoakLamp/state/set", "ON"},
+    {"iskaerna/SoakLamp/brightness/set", "128"},
+    {"iskaerna/SoakLamp/rgb/set", "25,44,255"},
+    {"iskaerna/SoakLamp/effect/set", "rainbow"},
+    {"iskaerna/SoakLamp/effect/set", "moving_rainbow"},
+    {"iskaerna/SoakLamp/left/state/set", "ON"},
+    {"iskaerna/SoakLamp/left/brightness/set", "3"},
+    {"iskaerna/SoakLamp/left/rgb/set", "255,0,12"},
+    {"iskaerna/SoakLamp/left/effect/set", "pulse"},
+    {"iskaerna/SoakLamp/left/effect/set", "a_long_effect_16"},
+    {"iskaerna/SoakLamp/state/set", "OFF"},
+    {"iskaerna/SoakLamp/left/state/set", "OFF"},
+    // Ignored: unknown entity, unknown field and oversized payload
+    {"iskaerna/SoakLamp/right/state/set", "ON"},
+    {"iskaerna/SoakLamp/left/color/set", "ON"},
+    {"iskaerna/SoakLamp/rgb/set", "255,255,255,255,255,255,255,255,255"},
+};
+
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+static Config *config;
+static HaClient *client;
+
+// Deliver one command and run the client loop like the sketch does
+static void deliver(const char *topic, const char *payload)
+{
+    TEST_ASSERT_TRUE_MESSAGE(mqttBroker.send(topic, payload), topic);
+    client->loop();
+}
+
+static void replayCommands(unsigned long count)
+{
+    for (unsigned long i = 0; i < count; i++)
+    {
+        deliver(commands[i % COMMAND_COUNT][0], commands[i % COMMAND_COUNT][1]);
+    }
+}
+
+static void startClient()
+{
+    config = new Config("ssid", "pass", "localhost", 1883, "", "", "homeassistant", "SoakLamp");
+    std::vector<HaEntity> entities;
+    entities.push_back(HaEntity("", "Soak Lamp"));
+    entities.push_back(HaEntity("left", "Soak Lamp Left"));
+    client = new HaClient(
+        config,
+        entities,
+        [](int i)
+        { return lamps[i].on; },
+        [](int i)
+        { return lamps[i].brightness; },
+        [](int i)
+        { return std::make_tuple(lamps[i].r, lamps[i].g, lamps[i].b); },
+        [](int i)
+        { return lamps[i].effect.c_str(); },
+        [](int i, bool on)
+        { lamps[i].on = on; },
+        [](int i, int brightness)
+        { lamps[i].brightness = brightness; },
+        [](int i, int r, int g, int b)
+        {
+            lamps[i].r = r;
+            lamps[i].g = g;
+            lamps[i].b = b;
+        },
+        [](int i, const char *effect)
+        { lamps[i].effect = effect; },
+        [](String, const uint8_t *, unsigned int) {});
+    client->setup();
+    client->setEffects({"none", "rainbow", "pulse", "realtime", "moving_rainbow", "a_long_effect_16"});
+    client->loop();
+
+    // First pass grows the effect names to their final capacity
+    replayCommands(COMMAND_COUNT);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_connect_publishes_discovery_and_state()
+{
+    TEST_ASSERT_EQUAL_UINT32(1, mqttBroker.connects);
+    TEST_ASSERT_EQUAL_UINT32(0, heapModelFailures());
+
+    // Birth message resends discovery of both entities
+    unsigned long publishes = mqttBroker.publishes;
+    deliver("homeassistant/status", "online");
+    TEST_ASSERT_EQUAL_UINT32(publishes + 2, mqttBroker.publishes);
+    TEST_ASSERT_EQUAL_STRING("homeassistant/light/SoakLamp_left/config", mqttBroker.lastTopic);
+
+    deliver("iskaerna/SoakLamp/left/rgb/set", "1,2,3");
+    TEST_ASSERT_EQUAL_STRING("iskaerna/SoakLamp/left/rgb/status", mqttBroker.lastTopic);
+    TEST_ASSERT_EQUAL_STRING("1,2,3", mqttBroker.lastPayload);
+}
+
+void test_commands_do_not_allocate()
+{
+    uint32_t allocations = heapModelAllocations();
+    uint32_t freeHeap = heapModelFree();
+    uint32_t largestBlock = heapModelLargestBlock();
+    unsigned long publishes = mqttBroker.publishes;
+
+    replayCommands(SOAK_COMMANDS);
+
+    TEST_ASSERT_EQUAL_UINT32(allocations, heapModelAllocations());
+    TEST_ASSERT_EQUAL_UINT32(freeHeap, heapModelFree());
+    TEST_ASSERT_EQUAL_UINT32(largestBlock, heapModelLargestBlock());
+    TEST_ASSERT_TRUE(mqttBroker.publishes > publishes);
+}
+
+void test_mixed_traffic_keeps_heap_bounded()
+{
+    uint32_t liveBlocks = heapModelLiveBlocks();
+    uint32_t freeHeap = heapModelFree();
+    uint32_t largestBlock = heapModelLargestBlock();
+    unsigned long connects = mqttBroker.connects;
+    heapModelResetLowWater();
+
+    for (unsigned long i = 0; i < SOAK_MIXED_COMMANDS; i++)
+    {
+        if (i % SOAK_BIRTH_INTERVAL == 0)
+        {
+            deliver("homeassistant/status", "online");
+        }
+        if (i % SOAK_RECONNECT_INTERVAL == 0)
+        {
+            mqttBroker.disconnect();
+            client->loop();
+        }
+        deliver(commands[i % COMMAND_COUNT][0], commands[i % COMMAND_COUNT][1]);
+
+        // Transient buffers are gone after every loop
+        if (heapModelLiveBlocks() != liveBlocks)
+        {
+            TEST_FAIL_MESSAGE("Live allocations changed");
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(connects + SOAK_MIXED_COMMANDS / SOAK_RECONNECT_INTERVAL + 1, mqttBroker.connects);
+    TEST_ASSERT_EQUAL_UINT32(freeHeap, heapModelFree());
+    TEST_ASSERT_EQUAL_UINT32(largestBlock, heapModelLargestBlock());
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(freeHeap - SOAK_MAX_PEAK_USE, heapModelLowWater());
+    TEST_ASSERT_EQUAL_UINT32(0, heapModelFailures());
+}
+
+int main(int argc, char **argv)
+{
+    startClient();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_connect_publishes_discovery_and_state);
+    RUN_TEST(test_commands_do_not_allocate);
+    RUN_TEST(test_mixed_traffic_keeps_heap_bounded);
+    return UNITY_END();
+}